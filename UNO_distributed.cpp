@@ -0,0 +1,487 @@
+/**
+*
+* Solution to course project # 4
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2025/2026
+*
+* @author Rangel Parishev
+* @idnumber 0MI0600668
+* @compiler GCC or Clang (-std=c++17 -pthread), VS (C++17)
+*
+* <distributed simulation>
+*
+*/
+// ---------- Libraries ----------
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <ctime>
+#include <chrono>
+#include <thread>
+#include <atomic>
+
+#include "UNO_project_final.h"
+#include "UNO_sockets.h"
+#include "UNO_metrics.h"
+#include "UNO_distributed.h"
+
+using namespace std;
+
+// ---------- Distributed simulation ----------
+// uno --coordinate hands out seed ranges of one --simulate run to worker
+// processes (uno --work) and adds up what they send back. Ranges are a
+// fixed split of the run, and game n still uses seed + n, so the totals are
+// those of the same run under --simulate whichever worker plays a range.
+// While it plays a range, a worker sends a heartbeat every second. A worker
+// that disconnects, or sends nothing for --timeout seconds, is dropped and
+// its range goes back to the queue; how long a range takes does not matter.
+//
+// The protocol is one line per message. The coordinator sends
+//   config <players> <decks> <rules> <agents> <key>
+//   range <index> <first seed> <games>
+//   bye [mismatch]
+// and the worker answers
+//   ready <key>
+//   alive
+//   done <index> <games> <unfinished> <turns> <wins per seat...>
+// The key is simulationKey, which also covers the book and win model: a
+// worker whose files differ from the coordinator's is turned away.
+const int MAX_WORKERS = 256;
+const int DISTRIBUTED_RANGE = 4096;      // default games per range
+const int WORKER_HEARTBEAT_MS = 1000;
+const int WORKER_TIMEOUT_SECONDS = 10;   // default --timeout, at least 2 heartbeats
+const int WORKER_CONNECT_TRIES = 50;     // 100 ms apart
+const char* const DEFAULT_COORDINATOR = "7700";
+
+enum RangeState : unsigned char { RANGE_PENDING, RANGE_ASSIGNED, RANGE_DONE };
+
+struct SeedRange {
+    int firstGame;
+    int games;
+    RangeState state;
+};
+
+struct WorkerLink {
+    Socket socket;
+    LineReader in;
+    bool ready;       // answered config with the right key
+    int range;        // the range it plays, or -1
+    long long heardAt; // metricsClock() of its last message or heartbeat
+};
+
+struct Coordinator {
+    const SimulationConfig* config;
+    const char* agentText;
+    unsigned long long key;
+    SeedRange* ranges;
+    int rangeCount;
+    int firstPending; // no pending range before it
+    int done;
+    WorkerLink workers[MAX_WORKERS];
+    int workerCount;
+    int joined;
+    int lost;
+    int reassigned;
+    SimulationStats stats;
+};
+
+void dropWorker(Coordinator& c, int w, bool lost) {
+    WorkerLink& link = c.workers[w];
+    if (link.range >= 0) {
+        c.ranges[link.range].state = RANGE_PENDING;
+        if (link.range < c.firstPending) c.firstPending = link.range;
+        c.reassigned++;
+    }
+    if (lost) c.lost++;
+    closeSocket(link.socket);
+    c.workers[w] = c.workers[--c.workerCount];
+}
+
+// Gives an idle worker the first pending range, if any is left.
+bool assignRange(Coordinator& c, WorkerLink& link) {
+    while (c.firstPending < c.rangeCount && c.ranges[c.firstPending].state != RANGE_PENDING) c.firstPending++;
+    if (c.firstPending == c.rangeCount) return true;
+
+    SeedRange& r = c.ranges[c.firstPending];
+    char line[SOCKET_LINE_LENGTH];
+    snprintf(line, sizeof(line), "range %d %llu %d\n", c.firstPending, c.config->firstSeed + r.firstGame, r.games);
+    r.state = RANGE_ASSIGNED;
+    link.range = c.firstPending;
+    link.heardAt = metricsClock(); // an idle worker may have been quiet for long
+    return sendLine(link.socket, line);
+}
+
+// Handles one line from a worker; false drops it.
+bool handleWorkerLine(Coordinator& c, WorkerLink& link, char* line) {
+    char* rest;
+    if (strncmp(line, "ready ", 6) == 0 && !link.ready) {
+        unsigned long long key = strtoull(line + 6, &rest, 16);
+        if (key != c.key) {
+            cout << "A worker runs a different configuration (engine version, book or model); turned away\n";
+            sendLine(link.socket, "bye mismatch\n");
+            return false;
+        }
+        link.ready = true;
+        c.joined++;
+        return assignRange(c, link);
+    }
+    if (strcmp(line, "alive") == 0 && link.range >= 0) return true;
+    if (strncmp(line, "done ", 5) == 0 && link.range >= 0) {
+        SimulationStats s;
+        clearStats(s);
+        int index = (int)strtol(line + 5, &rest, 10);
+        s.games = (int)strtol(rest, &rest, 10);
+        s.unfinished = (int)strtol(rest, &rest, 10);
+        s.turns = strtoll(rest, &rest, 10);
+        int won = 0;
+        for (int i = 0; i < c.config->playersCount; i++) {
+            s.wins[i] = (int)strtol(rest, &rest, 10);
+            if (s.wins[i] < 0) return false;
+            won += s.wins[i];
+        }
+        if (index != link.range || s.games != c.ranges[index].games || won + s.unfinished != s.games) return false;
+
+        addStats(c.stats, s);
+        c.ranges[index].state = RANGE_DONE;
+        c.done++;
+        link.range = -1;
+        return assignRange(c, link);
+    }
+    return false;
+}
+
+void acceptWorker(Coordinator& c, Socket listener) {
+    Socket s = accept(listener, 0, 0);
+    if (s == NO_SOCKET) return;
+    if (c.workerCount == MAX_WORKERS) {
+        closeSocket(s);
+        return;
+    }
+    char line[SOCKET_LINE_LENGTH];
+    const SimulationConfig& config = *c.config;
+    snprintf(line, sizeof(line), "config %d %d %d %s %llx\n", config.playersCount, config.deckCount, config.rules,
+        c.agentText, c.key);
+    if (!sendLine(s, line)) {
+        closeSocket(s);
+        return;
+    }
+    WorkerLink& link = c.workers[c.workerCount++];
+    link.socket = s;
+    link.in.length = 0;
+    link.ready = false;
+    link.range = -1;
+    link.heardAt = metricsClock();
+}
+
+// Serves workers until every range is done. Returns false if listening
+// failed.
+bool runCoordinator(Coordinator& c, const sockaddr_in& addr, int timeoutSeconds) {
+    Socket listener = listenOn(addr);
+    if (listener == NO_SOCKET) return false;
+
+    SocketPoll polls[MAX_WORKERS + 1];
+    while (c.done < c.rangeCount) {
+        polls[0].fd = listener;
+        polls[0].events = POLLIN;
+        polls[0].revents = 0;
+        for (int w = 0; w < c.workerCount; w++) {
+            polls[w + 1].fd = c.workers[w].socket;
+            polls[w + 1].events = POLLIN;
+            polls[w + 1].revents = 0;
+        }
+        int polled = c.workerCount;
+        if (pollSockets(polls, polled + 1, 1000) < 0) continue;
+
+        // Backwards, so dropping a worker (the last one takes its place)
+        // leaves the workers still to visit where they were.
+        long long now = metricsClock();
+        for (int w = polled - 1; w >= 0; w--) {
+            WorkerLink& link = c.workers[w];
+            if (polls[w + 1].revents) {
+                bool ok = receiveLines(link.socket, link.in);
+                char line[SOCKET_LINE_LENGTH];
+                while (ok && nextLine(link.in, line)) ok = handleWorkerLine(c, link, line);
+                if (!ok) {
+                    dropWorker(c, w, link.ready);
+                    continue;
+                }
+                link.heardAt = now;
+            }
+            else if (link.range >= 0 && now - link.heardAt > timeoutSeconds * 1000000000LL) {
+                dropWorker(c, w, true);
+            }
+        }
+        // Ranges of lost workers go to whoever is idle.
+        for (int w = c.workerCount - 1; w >= 0; w--) {
+            WorkerLink& link = c.workers[w];
+            if (link.ready && link.range < 0 && !assignRange(c, link)) dropWorker(c, w, true);
+        }
+        if (polls[0].revents) acceptWorker(c, listener);
+    }
+
+    for (int w = 0; w < c.workerCount; w++) {
+        sendLine(c.workers[w].socket, "bye\n");
+        closeSocket(c.workers[w].socket);
+    }
+    c.workerCount = 0;
+    closeSocket(listener);
+    return true;
+}
+
+int coordinateCommand(int argc, char* argv[]) {
+    int games = 1000;
+    int playersCount = 4;
+    int deckCount = 1;
+    int rules = RULES_STANDARD;
+    const char* agentText = 0;
+    unsigned long long seed = (unsigned long long)time(0);
+    const char* endpoint = DEFAULT_COORDINATOR;
+    int rangeGames = DISTRIBUTED_RANGE;
+    int timeoutSeconds = WORKER_TIMEOUT_SECONDS;
+    const char* bookPath = 0;
+    const char* modelPath = 0;
+
+    bool argsOk = true;
+    int positional = 0;
+    for (int i = 2; i < argc; i++) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (strcmp(arg, "--listen") == 0 && hasValue) endpoint = argv[++i];
+        else if (strcmp(arg, "--seed") == 0 && hasValue) seed = strtoull(argv[++i], 0, 10);
+        else if (strcmp(arg, "--range") == 0 && hasValue) rangeGames = atoi(argv[++i]);
+        else if (strcmp(arg, "--timeout") == 0 && hasValue) timeoutSeconds = atoi(argv[++i]);
+        else if (strcmp(arg, "--book") == 0 && hasValue) bookPath = argv[++i];
+        else if (strcmp(arg, "--model") == 0 && hasValue) modelPath = argv[++i];
+        else if (arg[0] == '-' && arg[1] == '-') argsOk = false;
+        else if (positional == 0) { games = atoi(arg); positional++; }
+        else if (positional == 1) { playersCount = atoi(arg); positional++; }
+        else if (positional == 2) { deckCount = atoi(arg); positional++; }
+        else if (positional == 3) { rules = atoi(arg); positional++; }
+        else if (positional == 4) { agentText = arg; positional++; }
+        else argsOk = false;
+    }
+
+    SimulationConfig config;
+    config.playersCount = playersCount;
+    config.deckCount = deckCount;
+    config.rules = rules;
+    config.firstSeed = seed;
+    config.batchSize = 1;
+    config.lockstep = false;
+    config.book = 0;
+    config.model = 0;
+    config.gameTable = 0;
+    config.turnTable = 0;
+    for (int i = 0; i < MAX_PLAYERS; i++) config.agents[i] = AGENT_BOT;
+    bool agentsOk = !agentText || parseAgents(agentText, playersCount, config.agents);
+
+    char defaultAgents[MAX_PLAYERS + 1];
+    if (!agentText && playersCount >= MIN_PLAYERS && playersCount <= MAX_PLAYERS) {
+        memset(defaultAgents, 'b', playersCount);
+        defaultAgents[playersCount] = '\0';
+        agentText = defaultAgents;
+    }
+
+    sockaddr_in addr;
+    if (!argsOk || games <= 0 || playersCount < MIN_PLAYERS || playersCount > MAX_PLAYERS ||
+        deckCount < 1 || deckCount > MAX_DECKS || rules < 0 || rules >= RULE_COMBINATIONS || !agentsOk ||
+        rangeGames < 1 || timeoutSeconds * 1000 < 2 * WORKER_HEARTBEAT_MS || !parseEndpoint(endpoint, addr)) {
+        cout << "Usage: --coordinate <games> [players 2-" << MAX_PLAYERS << "] [decks 1-" << MAX_DECKS
+            << "] [rules 0-" << (RULE_COMBINATIONS - 1) << "] [agents, one of b/e/o/r per seat]\n"
+            << "       [--listen [ADDRESS:]PORT] [--seed S] [--range GAMES] [--timeout SECONDS, 2 or more]"
+            << " [--book FILE] [--model FILE]\n"
+            << "Workers join with --work [ADDRESS:]PORT and the same --book and --model files.\n";
+        return 1;
+    }
+
+    WinModel model;
+    if (modelPath) {
+        if (!readSolverModel(modelPath, model)) return 1;
+        config.model = &model;
+    }
+    OpeningBook* book = 0;
+    if (bookPath) {
+        book = openOpeningBook(bookPath);
+        if (!book) {
+            cout << "Cannot read opening book " << bookPath << "\n";
+            return 1;
+        }
+        config.book = book;
+    }
+
+    Coordinator* c = new Coordinator();
+    c->config = &config;
+    c->agentText = agentText;
+    c->key = simulationKey(config);
+    c->rangeCount = (games + rangeGames - 1) / rangeGames;
+    c->ranges = new SeedRange[c->rangeCount];
+    for (int r = 0; r < c->rangeCount; r++) {
+        c->ranges[r].firstGame = r * rangeGames;
+        c->ranges[r].games = games - r * rangeGames < rangeGames ? games - r * rangeGames : rangeGames;
+        c->ranges[r].state = RANGE_PENDING;
+    }
+    c->firstPending = 0;
+    c->done = 0;
+    c->workerCount = 0;
+    c->joined = 0;
+    c->lost = 0;
+    c->reassigned = 0;
+    clearStats(c->stats);
+
+    cout << "Waiting for workers on " << endpoint << " (" << c->rangeCount << " ranges)\n" << flush;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    bool ok = startSockets() && runCoordinator(*c, addr, timeoutSeconds);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (book) closeOpeningBook(book);
+
+    int status = 0;
+    if (!ok) {
+        cout << "Cannot listen on " << endpoint << "\n";
+        status = 1;
+    }
+    else {
+        printSimulationTotals(c->stats, seed, playersCount);
+        cout << "Workers: " << c->joined << " joined, " << c->lost << " lost, " << c->reassigned << " ranges reassigned\n";
+        cout << "Time: " << seconds << " s";
+        if (seconds > 0) cout << " (" << (int)(c->stats.games / seconds) << " games/s)";
+        cout << "\n";
+    }
+    delete[] c->ranges;
+    delete c;
+    return status;
+}
+
+// Sends "alive" every WORKER_HEARTBEAT_MS until playing is set to false.
+// The worker's own thread sends nothing while this runs.
+void sendHeartbeats(Socket s, atomic<bool>* playing) {
+    while (true) {
+        for (int waited = 0; waited < WORKER_HEARTBEAT_MS; waited += 50) {
+            if (!playing->load(memory_order_acquire)) return;
+            this_thread::sleep_for(chrono::milliseconds(50));
+        }
+        if (!sendLine(s, "alive\n")) return;
+    }
+}
+
+int workCommand(int argc, char* argv[]) {
+    const char* endpoint = DEFAULT_COORDINATOR;
+    int threads = (int)thread::hardware_concurrency();
+    if (threads < 1) threads = 1;
+    bool lockstep = false;
+    const char* bookPath = 0;
+    const char* modelPath = 0;
+
+    bool argsOk = true;
+    int positional = 0;
+    for (int i = 2; i < argc; i++) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (strcmp(arg, "--threads") == 0 && hasValue) threads = atoi(argv[++i]);
+        else if (strcmp(arg, "--lockstep") == 0) lockstep = true;
+        else if (strcmp(arg, "--book") == 0 && hasValue) bookPath = argv[++i];
+        else if (strcmp(arg, "--model") == 0 && hasValue) modelPath = argv[++i];
+        else if (arg[0] == '-' && arg[1] == '-') argsOk = false;
+        else if (positional == 0) { endpoint = arg; positional++; }
+        else argsOk = false;
+    }
+    sockaddr_in addr;
+    if (!argsOk || threads < 1 || threads > MAX_SIMULATION_THREADS || !parseEndpoint(endpoint, addr)) {
+        cout << "Usage: --work [[ADDRESS:]PORT] [--threads 1-" << MAX_SIMULATION_THREADS << "] [--lockstep]"
+            << " [--book FILE] [--model FILE]\n";
+        return 1;
+    }
+
+    WinModel model;
+    if (modelPath && !readSolverModel(modelPath, model)) return 1;
+    OpeningBook* book = bookPath ? openOpeningBook(bookPath) : 0;
+    if (bookPath && !book) {
+        cout << "Cannot read opening book " << bookPath << "\n";
+        return 1;
+    }
+
+    // The coordinator may still be starting up.
+    Socket s = NO_SOCKET;
+    for (int tries = 0; startSockets() && s == NO_SOCKET && tries < WORKER_CONNECT_TRIES; tries++) {
+        s = connectTo(addr);
+        if (s == NO_SOCKET) this_thread::sleep_for(chrono::milliseconds(100));
+    }
+    if (s == NO_SOCKET) {
+        cout << "Cannot reach a coordinator on " << endpoint << "\n";
+        if (book) closeOpeningBook(book);
+        return 1;
+    }
+
+    SimulationConfig config;
+    config.batchSize = 1;
+    config.lockstep = false;
+    config.book = book;
+    config.model = modelPath ? &model : 0;
+    config.gameTable = 0;
+    config.turnTable = 0;
+
+    LineReader in;
+    in.length = 0;
+    char line[SOCKET_LINE_LENGTH];
+    const char* lost = "the coordinator went away";
+    const char* problem = 0;
+    bool configured = false, finished = false;
+    int ranges = 0;
+    long long games = 0;
+    while (!finished && !problem) {
+        if (!nextLine(in, line)) {
+            if (!receiveLines(s, in)) problem = lost;
+            continue;
+        }
+
+        char agents[MAX_PLAYERS + 2];
+        unsigned long long key, first;
+        int index, count;
+        if (!configured && sscanf(line, "config %d %d %d %11s %llx", &config.playersCount, &config.deckCount,
+            &config.rules, agents, &key) == 5) {
+            if (config.playersCount < MIN_PLAYERS || config.playersCount > MAX_PLAYERS || config.deckCount < 1 ||
+                config.deckCount > MAX_DECKS || config.rules < 0 || config.rules >= RULE_COMBINATIONS ||
+                !parseAgents(agents, config.playersCount, config.agents)) {
+                problem = "the coordinator sent an invalid configuration";
+                continue;
+            }
+            config.lockstep = lockstep && canPlayLockstep(config);
+            config.batchSize = config.lockstep ? LOCKSTEP_BATCH : 1;
+            snprintf(line, sizeof(line), "ready %llx\n", simulationKey(config));
+            if (!sendLine(s, line)) problem = lost;
+            configured = true;
+        }
+        else if (configured && sscanf(line, "range %d %llu %d", &index, &first, &count) == 3 && count > 0) {
+            SimulationStats stats;
+            config.firstSeed = first;
+            atomic<bool> playing(true);
+            thread heartbeat(sendHeartbeats, s, &playing);
+            runSimulation(config, count, threads, stats);
+            playing.store(false, memory_order_release);
+            heartbeat.join();
+
+            int n = snprintf(line, sizeof(line), "done %d %d %d %lld", index, stats.games, stats.unfinished, stats.turns);
+            for (int i = 0; i < config.playersCount; i++) n += snprintf(line + n, sizeof(line) - n, " %d", stats.wins[i]);
+            snprintf(line + n, sizeof(line) - n, "\n");
+            if (!sendLine(s, line)) problem = lost;
+            ranges++;
+            games += count;
+        }
+        else if (strcmp(line, "bye") == 0) finished = true;
+        else if (strcmp(line, "bye mismatch") == 0) {
+            problem = "the coordinator runs a different configuration (engine version, book or model)";
+        }
+        else problem = "unexpected message from the coordinator";
+    }
+    closeSocket(s);
+    if (book) closeOpeningBook(book);
+
+    cout << "Worker: " << ranges << " ranges, " << games << " games\n";
+    if (problem) {
+        cout << "Stopped: " << problem << "\n";
+        return 1;
+    }
+    return 0;
+}
+
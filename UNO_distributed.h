@@ -0,0 +1,31 @@
+/**
+*
+* Solution to course project # 4
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2025/2026
+*
+* @author Rangel Parishev
+* @idnumber 0MI0600668
+* @compiler GCC or Clang (-std=c++17 -pthread), VS (C++17)
+*
+* <distributed simulation>
+*
+*/
+#ifndef UNO_DISTRIBUTED_H
+#define UNO_DISTRIBUTED_H
+
+// ---------- Distributed simulation ----------
+// One --simulate run split into seed ranges, played by worker processes
+// over TCP (see UNO_distributed.cpp for the protocol).
+
+// uno --coordinate <games> [players] [decks] [rules] [agents]
+//     [--listen [ADDRESS:]PORT] [--seed S] [--range N] [--timeout SECONDS]
+//     [--book FILE] [--model FILE]
+int coordinateCommand(int argc, char* argv[]);
+
+// uno --work [ADDRESS:]PORT [--threads N] [--lockstep] [--book FILE] [--model FILE]
+// Plays the ranges a coordinator hands out on all threads, until it says bye.
+int workCommand(int argc, char* argv[]);
+
+#endif
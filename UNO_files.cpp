@@ -0,0 +1,68 @@
+/**
+*
+* Solution to course project # 4
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2025/2026
+*
+* @author Rangel Parishev
+* @idnumber 0MI0600668
+* @compiler GCC or Clang (-std=c++17 -pthread), VS (C++17)
+*
+* <durable file writes>
+*
+*/
+// ---------- Libraries ----------
+#include <cstdio>
+#include <cstring>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <io.h>
+#include <process.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "UNO_files.h"
+
+// ---------- Files ----------
+bool syncFile(FILE* f) {
+#ifdef _WIN32
+    return _commit(_fileno(f)) == 0;
+#else
+    return fsync(fileno(f)) == 0;
+#endif
+}
+
+bool replaceFile(const char* from, const char* to) {
+#ifdef _WIN32
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    if (rename(from, to) != 0) return false;
+    // Sync the directory as well, so the rename itself survives a crash.
+    char dir[512] = ".";
+    const char* slash = strrchr(to, '/');
+    if (slash && slash - to < (int)sizeof(dir)) {
+        memcpy(dir, to, slash - to);
+        dir[slash > to ? slash - to : 1] = '\0';
+    }
+    int fd = open(dir, O_RDONLY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+    return true;
+#endif
+}
+
+int processId() {
+#ifdef _WIN32
+    return _getpid();
+#else
+    return (int)getpid();
+#endif
+}
+
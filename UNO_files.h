@@ -0,0 +1,42 @@
+/**
+*
+* Solution to course project # 4
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2025/2026
+*
+* @author Rangel Parishev
+* @idnumber 0MI0600668
+* @compiler GCC or Clang (-std=c++17 -pthread), VS (C++17)
+*
+* <durable file writes>
+*
+*/
+#ifndef UNO_FILES_H
+#define UNO_FILES_H
+
+#include <cstdio>
+#include <streambuf>
+
+// ostream over a C file, whose descriptor can be synced to disk.
+struct StdioBuffer : std::streambuf {
+    FILE* file;
+    StdioBuffer(FILE* f) : file(f) {}
+    int overflow(int c) {
+        if (c == EOF) return 0;
+        return fputc(c, file) == EOF ? EOF : c;
+    }
+    std::streamsize xsputn(const char* s, std::streamsize n) {
+        return (std::streamsize)fwrite(s, 1, (size_t)n, file);
+    }
+};
+
+bool syncFile(FILE* f);
+
+// Atomically replaces to with from.
+bool replaceFile(const char* from, const char* to);
+
+// For temporary names that other processes must not share.
+int processId();
+
+#endif
@@ -0,0 +1,260 @@
+/**
+*
+* Solution to course project # 4
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2025/2026
+*
+* @author Rangel Parishev
+* @idnumber 0MI0600668
+* @compiler GCC or Clang (-std=c++17 -pthread), VS (C++17)
+*
+* <remote tables>
+*
+*/
+// ---------- Libraries ----------
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <ctime>
+
+#include "UNO_project_final.h"
+#include "UNO_metrics.h"
+#include "UNO_host.h"
+
+using namespace std;
+
+// ---------- Remote tables ----------
+// One thread hosts many games whose remote seats answer at their own pace.
+// A game runs through the turn pipeline until a remote seat has to move,
+// then it is parked with the phase it stopped at; a move arriving for it
+// resumes that game alone, and every other game stays parked meanwhile.
+//
+// The protocol is one line per message. The host prints
+//   wait <table> <seat> <play|drawn|stack> <top card> <color> <pending> <hand...>
+//   over <table> <winner seat, 0 if abandoned> <turns>
+//   error <table> <reason>
+// and reads "<table> <choice> [R|G|B|Y] [swap seat] [uno]" lines. Tables
+// and seats count from 1, cards are hand slots from 0 as printed.
+const int MAX_REMOTE_TABLES = 100000;
+const int REMOTE_LINE_LENGTH = 256;
+
+struct RemoteTable {
+    GameState g;
+    TurnPhase phase;  // the phase the game is parked at
+    bool waiting;     // parked until its remote seat moves
+    bool over;
+    long long parkedAt; // metricsClock() when it was parked
+    int parkedTurns;    // g.turns before the parked step was observed
+};
+
+// A remote seat has to answer phase; everything else is decided here.
+bool needsRemoteMove(const GameState& g, TurnPhase phase) {
+    if (!isRemote(g, g.currentPlayer)) return false;
+    if (phase == PHASE_PLAY || phase == PHASE_PLAY_DRAWN) return true;
+    return phase == PHASE_PENDING_DRAW && hasStackableCard(g.players[g.currentPlayer], g.topCard);
+}
+
+// Runs the table until a remote seat has to move or the game ends; the move
+// for the parked phase must be in t.g.remoteMove. Returns true when over.
+bool advanceRemoteTable(RemoteTable& t) {
+    GameState& g = t.g;
+    const GameEngine& engine = gameEngine(g.rules);
+    while (true) {
+        long long start = 0;
+        int turns = g.turns;
+        if (!t.waiting) {
+            t.phase = engine.observe(g);
+            if (needsRemoteMove(g, t.phase)) {
+                t.waiting = true;
+                t.parkedTurns = turns;
+                if (g.metrics) t.parkedAt = metricsClock();
+                return false;
+            }
+            if (g.metrics) start = metricsClock();
+        }
+        else {
+            start = t.parkedAt; // a remote decision lasts from the prompt to the move
+            turns = t.parkedTurns;
+        }
+        t.waiting = false;
+        int choice = decideTurn(g, t.phase);
+        if (!g.metrics) {
+            if (engine.resolve(g, t.phase, choice)) return true;
+            continue;
+        }
+        long long decided = metricsClock();
+        bool over = engine.resolve(g, t.phase, choice);
+        recordTurnMetrics(*g.metrics, g.turns != turns, start, decided, metricsClock());
+        if (over) return true;
+    }
+}
+
+// Why m cannot answer the phase g is parked at, or 0.
+const char* checkRemoteMove(const GameState& g, TurnPhase phase, const RemoteMove& m) {
+    const Player& p = g.players[g.currentPlayer];
+    Card card;
+    if (phase == PHASE_PLAY_DRAWN) {
+        if (m.choice != 0 && m.choice != 1) return "answer 1 to play the drawn card or 0 to keep it";
+        if (m.choice == 0) return 0;
+        card = p.hand[p.cardCount - 1];
+    }
+    else if (phase == PHASE_PENDING_DRAW && m.choice == -2) return 0;
+    else {
+        if (m.choice < 0 || m.choice >= p.cardCount) return "no such card";
+        card = p.hand[m.choice];
+        if (phase == PHASE_PENDING_DRAW && !isStackable(card, g.topCard)) return "card does not stack";
+        if (phase == PHASE_PLAY && !isValidMove(card, g.topCard, g.activeColor)) return "card cannot be played";
+    }
+    if (card.color == WILD && (m.color < 0 || m.color >= WILD)) return "a wild needs a color";
+    if ((g.rules & RULE_SEVEN_ZERO) && card.value == SEVEN &&
+        (m.swapTarget < 0 || m.swapTarget >= g.playersCount || m.swapTarget == g.currentPlayer)) {
+        return "a 7 needs another seat to swap with";
+    }
+    return 0;
+}
+
+// Parses "<table> <choice> [color] [swap seat] [uno]"; table counts from 1.
+bool parseRemoteMove(char* line, int& table, RemoteMove& m) {
+    m.color = -1;
+    m.swapTarget = -1;
+    m.uno = false;
+
+    char* token = strtok(line, " \t\r");
+    if (!token) return false;
+    table = atoi(token);
+    token = strtok(0, " \t\r");
+    if (!token) return false;
+    m.choice = atoi(token);
+
+    while ((token = strtok(0, " \t\r"))) {
+        if (strcmp(token, "uno") == 0 || strcmp(token, "UNO") == 0) m.uno = true;
+        else if (token[0] == 'R' && !token[1]) m.color = RED;
+        else if (token[0] == 'G' && !token[1]) m.color = GREEN;
+        else if (token[0] == 'B' && !token[1]) m.color = BLUE;
+        else if (token[0] == 'Y' && !token[1]) m.color = YELLOW;
+        else if (token[0] >= '1' && token[0] <= '9') m.swapTarget = atoi(token) - 1;
+        else return false;
+    }
+    return true;
+}
+
+void printRemoteWait(ostream& out, int table, const RemoteTable& t) {
+    const GameState& g = t.g;
+    const Player& p = g.players[g.currentPlayer];
+    const char* phase = t.phase == PHASE_PLAY_DRAWN ? "drawn" : t.phase == PHASE_PENDING_DRAW ? "stack" : "play";
+    out << "wait " << (table + 1) << " " << (g.currentPlayer + 1) << " " << phase << " ";
+    printCard(out, g.topCard);
+    out << " " << colorToChar(g.activeColor) << " " << g.pendingDraw;
+    for (int i = 0; i < p.cardCount; i++) {
+        out << " ";
+        printCard(out, p.hand[i]);
+    }
+    out << "\n";
+}
+
+// Steps a table after a move (or at the start) and reports where it stopped.
+void runRemoteTable(ostream& out, int table, RemoteTable& t, int& open) {
+    t.over = advanceRemoteTable(t);
+    if (!t.over) {
+        printRemoteWait(out, table, t);
+        return;
+    }
+    out << "over " << (table + 1) << " " << (t.g.winner + 1) << " " << t.g.turns << "\n";
+    if (t.g.metrics) finishMeteredGame(*t.g.metrics, t.g.winner >= 0);
+    open--;
+}
+
+int hostCommand(int argc, char* argv[]) {
+    int tables = 0;
+    const char* seats = "nbbb";
+    int rules = RULES_STANDARD;
+    unsigned long long seed = (unsigned long long)time(0);
+    const char* metricsPath = 0;
+
+    bool argsOk = true;
+    int positional = 0;
+    for (int i = 2; i < argc; i++) {
+        const char* arg = argv[i];
+        if (strcmp(arg, "--seed") == 0 && i + 1 < argc) seed = strtoull(argv[++i], 0, 10);
+        else if (strcmp(arg, "--metrics") == 0 && i + 1 < argc) metricsPath = argv[++i];
+        else if (arg[0] == '-' && arg[1] == '-') argsOk = false;
+        else if (positional == 0) { tables = atoi(arg); positional++; }
+        else if (positional == 1) { seats = arg; positional++; }
+        else if (positional == 2) { rules = atoi(arg); positional++; }
+        else argsOk = false;
+    }
+
+    // Seat letters as for --simulate, plus n for a remote seat.
+    int playersCount = (int)strlen(seats);
+    AgentKind agents[MAX_PLAYERS];
+    if (playersCount < MIN_PLAYERS || playersCount > MAX_PLAYERS) argsOk = false;
+    for (int i = 0; argsOk && i < playersCount; i++) {
+        char letter[2] = { seats[i], 0 };
+        if (seats[i] == 'n') agents[i] = AGENT_REMOTE;
+        else argsOk = parseAgents(letter, 1, &agents[i]);
+    }
+    if (!argsOk || tables <= 0 || tables > MAX_REMOTE_TABLES || rules < 0 || rules >= RULE_COMBINATIONS) {
+        cout << "Usage: --host <tables 1-" << MAX_REMOTE_TABLES << "> [seats, e.g. nbbb] [rules 0-"
+            << (RULE_COMBINATIONS - 1) << "] [--seed S] [--metrics FILE]\n";
+        return 1;
+    }
+
+    Metrics* metrics = metricsPath ? createMetrics(metricsPath) : 0;
+    ArenaPool pool = {};
+    ostream silent(0);
+    RemoteTable* all = new RemoteTable[tables];
+    int open = tables;
+    for (int n = 0; n < tables; n++) {
+        RemoteTable& t = all[n];
+        t.g = GameState();
+        createGame(t.g, pool, playersCount, 1, rules);
+        seedGame(t.g, seed + n);
+        t.g.out = &silent;
+        setRender(t.g, false);
+        for (int i = 0; i < playersCount; i++) t.g.players[i].agent = agents[i];
+        newShuffledDeck(t.g);
+        dealInitialCards(t.g);
+        startTopCard(t.g);
+        t.waiting = false;
+        t.g.metrics = metrics;
+        if (metrics) startMeteredGame(*metrics);
+        runRemoteTable(cout, n, t, open);
+    }
+    cout.flush();
+
+    char line[REMOTE_LINE_LENGTH];
+    while (open > 0 && cin.getline(line, sizeof(line))) {
+        int table;
+        RemoteMove m;
+        if (!parseRemoteMove(line, table, m)) {
+            cout << "error 0 unreadable move\n";
+        }
+        else if (table < 1 || table > tables || !all[table - 1].waiting) {
+            cout << "error " << table << " not waiting for a move\n";
+        }
+        else {
+            RemoteTable& t = all[table - 1];
+            const char* problem = checkRemoteMove(t.g, t.phase, m);
+            if (problem) cout << "error " << table << " " << problem << "\n";
+            else {
+                t.g.remoteMove = m;
+                runRemoteTable(cout, table - 1, t, open);
+            }
+        }
+        cout.flush();
+    }
+
+    for (int n = 0; n < tables; n++) {
+        if (!all[n].over) {
+            cout << "over " << (n + 1) << " 0 " << all[n].g.turns << "\n";
+            if (metrics) finishMeteredGame(*metrics, false);
+        }
+        destroyGame(all[n].g, pool);
+    }
+    delete[] all;
+    destroyArenaPool(pool);
+    if (metrics) destroyMetrics(metrics);
+    return 0;
+}
+
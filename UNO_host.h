@@ -0,0 +1,23 @@
+/**
+*
+* Solution to course project # 4
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2025/2026
+*
+* @author Rangel Parishev
+* @idnumber 0MI0600668
+* @compiler GCC or Clang (-std=c++17 -pthread), VS (C++17)
+*
+* <remote tables>
+*
+*/
+#ifndef UNO_HOST_H
+#define UNO_HOST_H
+
+// ---------- Remote tables ----------
+// uno --host <tables> [seats] [rules] [--seed S] [--metrics FILE]
+// Hosts games for remote seats over stdin and stdout (see UNO_host.cpp).
+int hostCommand(int argc, char* argv[]);
+
+#endif
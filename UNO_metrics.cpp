@@ -0,0 +1,210 @@
+/**
+*
+* Solution to course project # 4
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2025/2026
+*
+* @author Rangel Parishev
+* @idnumber 0MI0600668
+* @compiler GCC or Clang (-std=c++17 -pthread), VS (C++17)
+*
+* <latency metrics>
+*
+*/
+// ---------- Libraries ----------
+#include <iostream>
+#include <iomanip>
+#include <cstdio>
+#include <cmath>
+#include <chrono>
+#include <thread>
+#include <atomic>
+
+#include "UNO_files.h"
+#include "UNO_metrics.h"
+
+using namespace std;
+
+// ---------- Metrics ----------
+// Histograms are log-linear, like HDR histograms: nanosecond values fall
+// into power-of-two ranges, each split into HISTOGRAM_SUB_BUCKETS linear
+// steps, so a bucket is never wider than 1/16 of its values.
+const int HISTOGRAM_SUB_BITS = 4;
+const int HISTOGRAM_SUB_BUCKETS = 1 << HISTOGRAM_SUB_BITS;
+const int HISTOGRAM_RANGES = 40;   // up to 2^40 ns, about 18 minutes
+const int HISTOGRAM_BUCKETS = HISTOGRAM_RANGES * HISTOGRAM_SUB_BUCKETS;
+const int METRICS_INTERVAL_MS = 1000;
+const int METRICS_POLL_MS = 50;    // exporter's check for stopping
+
+const char* const LATENCY_NAMES[LATENCY_KINDS] = {
+    "uno_turn_resolve_seconds", "uno_agent_decision_seconds", "uno_save_seconds", "uno_load_seconds"
+};
+const char* const LATENCY_HELP[LATENCY_KINDS] = {
+    "Time to apply a decision and its effects.",
+    "Time an agent took to decide, including waits for human and remote players.",
+    "Time to write a save file, manual or automatic.",
+    "Time to read a save file."
+};
+const double METRICS_QUANTILES[] = { 0.5, 0.9, 0.99, 0.999 };
+const int METRICS_QUANTILE_COUNT = sizeof(METRICS_QUANTILES) / sizeof(METRICS_QUANTILES[0]);
+
+struct LatencyHistogram {
+    atomic<unsigned long long> buckets[HISTOGRAM_BUCKETS];
+    atomic<unsigned long long> sumNanos;
+};
+
+struct Metrics {
+    LatencyHistogram latency[LATENCY_KINDS];
+    atomic<long long> gamesInProgress;
+    atomic<unsigned long long> gamesFinished;
+    atomic<unsigned long long> moves;
+
+    const char* path;
+    atomic<bool> stopping;
+    atomic<int> failures;   // exports that could not be written
+    thread exporter;
+};
+
+long long metricsClock() {
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int histogramBucket(unsigned long long nanos) {
+    if (nanos < (unsigned long long)HISTOGRAM_SUB_BUCKETS) return (int)nanos;
+    int top = 0; // index of the highest set bit
+    for (int shift = 32; shift > 0; shift >>= 1) {
+        if (nanos >> (top + shift)) top += shift;
+    }
+    int range = top - HISTOGRAM_SUB_BITS + 1;
+    if (range >= HISTOGRAM_RANGES) return HISTOGRAM_BUCKETS - 1;
+    int sub = (int)(nanos >> (top - HISTOGRAM_SUB_BITS)) & (HISTOGRAM_SUB_BUCKETS - 1);
+    return range * HISTOGRAM_SUB_BUCKETS + sub;
+}
+
+// The highest value that falls into bucket.
+unsigned long long histogramBucketTop(int bucket) {
+    int range = bucket / HISTOGRAM_SUB_BUCKETS;
+    unsigned long long sub = bucket % HISTOGRAM_SUB_BUCKETS;
+    if (range == 0) return sub;
+    return ((HISTOGRAM_SUB_BUCKETS + sub + 1) << (range - 1)) - 1;
+}
+
+void recordLatency(Metrics& m, LatencyKind kind, long long nanos) {
+    if (nanos < 0) nanos = 0;
+    LatencyHistogram& h = m.latency[kind];
+    h.buckets[histogramBucket((unsigned long long)nanos)].fetch_add(1, memory_order_relaxed);
+    h.sumNanos.fetch_add((unsigned long long)nanos, memory_order_relaxed);
+}
+
+void recordTurnMetrics(Metrics& m, bool newTurn, long long start, long long decided, long long resolved) {
+    recordLatency(m, LATENCY_DECIDE, decided - start);
+    recordLatency(m, LATENCY_RESOLVE, resolved - decided);
+    if (newTurn) m.moves.fetch_add(1, memory_order_relaxed);
+}
+
+void startMeteredGame(Metrics& m) {
+    m.gamesInProgress.fetch_add(1, memory_order_relaxed);
+}
+
+void finishMeteredGame(Metrics& m, bool won) {
+    m.gamesInProgress.fetch_sub(1, memory_order_relaxed);
+    if (won) m.gamesFinished.fetch_add(1, memory_order_relaxed);
+}
+
+void writeLatencyMetrics(ostream& out, const LatencyHistogram& h, const char* name, const char* help) {
+    // A snapshot of the buckets; recording goes on meanwhile.
+    unsigned long long counts[HISTOGRAM_BUCKETS];
+    unsigned long long total = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        counts[i] = h.buckets[i].load(memory_order_relaxed);
+        total += counts[i];
+    }
+
+    out << "# HELP " << name << " " << help << "\n";
+    out << "# TYPE " << name << " summary\n";
+    int bucket = 0;
+    unsigned long long seen = 0;
+    for (int q = 0; q < METRICS_QUANTILE_COUNT; q++) {
+        unsigned long long rank = (unsigned long long)ceil(METRICS_QUANTILES[q] * total);
+        while (bucket < HISTOGRAM_BUCKETS - 1 && seen + counts[bucket] < rank) seen += counts[bucket++];
+        out << name << "{quantile=\"" << METRICS_QUANTILES[q] << "\"} ";
+        if (total) out << histogramBucketTop(bucket) * 1e-9 << "\n";
+        else out << "NaN\n"; // no observations yet
+    }
+    out << name << "_sum " << h.sumNanos.load(memory_order_relaxed) * 1e-9 << "\n";
+    out << name << "_count " << total << "\n";
+}
+
+bool writeMetricsFile(const char* path, Metrics& m, double movesPerSecond) {
+    char temp[512];
+    if (snprintf(temp, sizeof(temp), "%s.tmp", path) >= (int)sizeof(temp)) return false;
+    FILE* f = fopen(temp, "w");
+    if (!f) return false;
+
+    StdioBuffer buffer(f);
+    ostream out(&buffer);
+    out << setprecision(6);
+    for (int k = 0; k < LATENCY_KINDS; k++) writeLatencyMetrics(out, m.latency[k], LATENCY_NAMES[k], LATENCY_HELP[k]);
+    out << "# HELP uno_games_in_progress Games being played.\n";
+    out << "# TYPE uno_games_in_progress gauge\n";
+    out << "uno_games_in_progress " << m.gamesInProgress.load(memory_order_relaxed) << "\n";
+    out << "# HELP uno_games_finished_total Games played to a winner.\n";
+    out << "# TYPE uno_games_finished_total counter\n";
+    out << "uno_games_finished_total " << m.gamesFinished.load(memory_order_relaxed) << "\n";
+    out << "# HELP uno_moves_total Turns played.\n";
+    out << "# TYPE uno_moves_total counter\n";
+    out << "uno_moves_total " << m.moves.load(memory_order_relaxed) << "\n";
+    out << "# HELP uno_moves_per_second Turns played per second over the last export interval.\n";
+    out << "# TYPE uno_moves_per_second gauge\n";
+    out << "uno_moves_per_second " << movesPerSecond << "\n";
+
+    bool ok = out.good() && fflush(f) == 0;
+    if (fclose(f) != 0) ok = false;
+    if (ok) ok = replaceFile(temp, path);
+    if (!ok) remove(temp);
+    return ok;
+}
+
+void runMetricsExporter(Metrics* m) {
+    long long lastTime = metricsClock();
+    unsigned long long lastMoves = 0;
+    while (true) {
+        bool stopping = false;
+        for (int waited = 0; waited < METRICS_INTERVAL_MS && !stopping; waited += METRICS_POLL_MS) {
+            this_thread::sleep_for(chrono::milliseconds(METRICS_POLL_MS));
+            stopping = m->stopping.load(memory_order_acquire);
+        }
+
+        long long now = metricsClock();
+        unsigned long long moves = m->moves.load(memory_order_relaxed);
+        double rate = now > lastTime ? (moves - lastMoves) * 1e9 / (now - lastTime) : 0;
+        lastTime = now;
+        lastMoves = moves;
+        if (!writeMetricsFile(m->path, *m, rate)) m->failures++;
+        if (stopping) return;
+    }
+}
+
+Metrics* createMetrics(const char* path) {
+    Metrics* m = new Metrics();
+    for (int k = 0; k < LATENCY_KINDS; k++) {
+        for (int i = 0; i < HISTOGRAM_BUCKETS; i++) m->latency[k].buckets[i].store(0);
+        m->latency[k].sumNanos.store(0);
+    }
+    m->gamesInProgress.store(0);
+    m->gamesFinished.store(0);
+    m->moves.store(0);
+    m->path = path;
+    m->stopping.store(false);
+    m->failures.store(0);
+    m->exporter = thread(runMetricsExporter, m);
+    return m;
+}
+
+void destroyMetrics(Metrics* m) {
+    m->stopping.store(true, memory_order_release);
+    m->exporter.join();
+    delete m;
+}
+
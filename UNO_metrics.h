@@ -0,0 +1,46 @@
+/**
+*
+* Solution to course project # 4
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2025/2026
+*
+* @author Rangel Parishev
+* @idnumber 0MI0600668
+* @compiler GCC or Clang (-std=c++17 -pthread), VS (C++17)
+*
+* <latency metrics>
+*
+*/
+#ifndef UNO_METRICS_H
+#define UNO_METRICS_H
+
+// ---------- Metrics ----------
+// Latency histograms and counters for hosted games. Recording is a few
+// relaxed atomic adds into fixed arrays: no locks and no allocation, so it
+// can stay on in production. An exporter thread rewrites a file in the
+// Prometheus text format every METRICS_INTERVAL_MS (for node_exporter's
+// textfile collector, or anything that scrapes the file), replacing it
+// atomically so a reader never sees half of it.
+
+enum LatencyKind { LATENCY_RESOLVE, LATENCY_DECIDE, LATENCY_SAVE, LATENCY_LOAD, LATENCY_KINDS };
+
+struct Metrics;
+
+long long metricsClock();
+void recordLatency(Metrics& m, LatencyKind kind, long long nanos);
+
+// One step of a game: decision and resolution, and a move when the step
+// started a turn.
+void recordTurnMetrics(Metrics& m, bool newTurn, long long start, long long decided, long long resolved);
+
+void startMeteredGame(Metrics& m);
+void finishMeteredGame(Metrics& m, bool won);
+
+// Starts the exporter, which writes path until destroyMetrics.
+Metrics* createMetrics(const char* path);
+
+// Writes the file a last time and stops the exporter.
+void destroyMetrics(Metrics* m);
+
+#endif
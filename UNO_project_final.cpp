@@ -7,49 +7,92 @@
 *
 * @author Rangel Parishev
 * @idnumber 0MI0600668
-* @compiler VS
+* @compiler GCC or Clang (-std=c++17 -pthread), VS (C++17)
 *
 * <c++ file with project>
 *
 */
 // ---------- Libraries ----------
 #include <iostream>
+#include <iomanip>
 #include <fstream>
+#include <cstring>
 #include <cstdlib>
 #include <ctime>
+#include <cstdio>
+#include <cmath>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
-using namespace std;
+#include "UNO_project_final.h"
+#include "UNO_files.h"
+#include "UNO_metrics.h"
+#include "UNO_spectator.h"
+#include "UNO_host.h"
+#include "UNO_distributed.h"
 
-// ---------- Constants ----------
-const int TOTAL_CARDS = 108;
-const int MAX_HAND = TOTAL_CARDS;
-const int MAX_PLAYERS = 4;
-const int MIN_PLAYERS = 2;
+using namespace std;
 
-// ---------- Enums and Structures ----------
-enum Color { RED, GREEN, BLUE, YELLOW, WILD };
+// ---------- Arena ----------
+// Header and buffer come from a single allocation.
+Arena* createArena(int capacity) {
+    char* block = new char[sizeof(Arena) + capacity];
+    Arena* a = (Arena*)block;
+    a->base = block + sizeof(Arena);
+    a->capacity = capacity;
+    a->used = 0;
+    a->next = 0;
+    return a;
+}
 
-enum Value {
-    ZERO, ONE, TWO, THREE, FOUR, FIVE, SIX, SEVEN, EIGHT, NINE,
-    SKIP, REVERSE, PLUS2, WILD_CARD, WILD_PLUS4
-};
+void* arenaAlloc(Arena& a, int bytes) {
+    int offset = (a.used + 7) & ~7;
+    if (offset + bytes > a.capacity) return 0;
+    a.used = offset + bytes;
+    return a.base + offset;
+}
 
-struct Card {
-    Color color;
-    Value value;
-};
+Arena* acquireArena(ArenaPool& pool, int capacity) {
+    Arena** link = &pool.freeList;
+    while (*link) {
+        Arena* a = *link;
+        if (a->capacity >= capacity) {
+            *link = a->next;
+            a->next = 0;
+            a->used = 0;
+            return a;
+        }
+        link = &a->next;
+    }
+    pool.arenasCreated++;
+    return createArena(capacity);
+}
 
-struct Player {
-    Card hand[MAX_HAND];
-    int cardCount;
-};
+void releaseArena(ArenaPool& pool, Arena* a) {
+    a->used = 0;
+    a->next = pool.freeList;
+    pool.freeList = a;
+}
 
-struct CardEffect {
-    int drawCount;     // 0, 2, 4
-    bool skipNext;     // Skip, +2, +4, Reverse (when 2 players)
-    bool reverseDir;   // Reverse (when 3-4 players)
-    bool chooseColor;  // Wild / Wild+4
-};
+void destroyArenaPool(ArenaPool& pool) {
+    while (pool.freeList) {
+        Arena* a = pool.freeList;
+        pool.freeList = a->next;
+        delete[] (char*)a;
+    }
+}
 
 // ---------- Utilities ----------
 char colorToChar(Color c) {
@@ -60,20 +103,20 @@ char colorToChar(Color c) {
     return 'W';
 }
 
-void printCard(const Card& c) {
+void printCard(ostream& out, const Card& c) {
     if (c.color == WILD) {
-        if (c.value == WILD_CARD) cout << "Wild";
-        else if (c.value == WILD_PLUS4) cout << "Wild+4";
-		else cout << "Wild?"; //fallback
+        if (c.value == WILD_CARD) out << "Wild";
+        else if (c.value == WILD_PLUS4) out << "Wild+4";
+		else out << "Wild?"; //fallback
         return;
     }
 
-    cout << colorToChar(c.color);
+    out << colorToChar(c.color);
 
-    if (c.value <= NINE) cout << (int)c.value;
-    else if (c.value == SKIP) cout << "Skip";
-    else if (c.value == REVERSE) cout << "Reverse";
-    else if (c.value == PLUS2) cout << "+2";
+    if (c.value <= NINE) out << (int)c.value;
+    else if (c.value == SKIP) out << "Skip";
+    else if (c.value == REVERSE) out << "Reverse";
+    else if (c.value == PLUS2) out << "+2";
 }
 
 
@@ -84,15 +127,49 @@ bool isValidMove(const Card& played, const Card& topCard, Color activeColor) {
     return false;
 }
 
+// Hand slots are unordered: the last card fills the gap, so removal from
+// the slots is O(1) and bots see the same slots as before. When the game is
+// shown, the sorted view (order, position, groupEnd) is kept up to date on
+// every add and remove; only the cards after the changed display position
+// move.
 void addToHand(Player& p, const Card& c) {
-    p.hand[p.cardCount++] = c;
+    int slot = p.cardCount++;
+    p.hand[slot] = c;
+    if (!p.order) return;
+
+    // After the last card of the same color with a value not above it, so
+    // equal cards keep the order they were drawn in.
+    int start = c.color > RED ? p.groupEnd[c.color - 1] : 0;
+    int pos = p.groupEnd[c.color];
+    while (pos > start && p.hand[p.order[pos - 1]].value > c.value) pos--;
+    for (int i = slot; i > pos; i--) {
+        p.order[i] = p.order[i - 1];
+        p.position[p.order[i]] = (short)i;
+    }
+    p.order[pos] = (short)slot;
+    p.position[slot] = (short)pos;
+    for (int k = c.color; k <= WILD; k++) p.groupEnd[k]++;
 }
 
 void removeCard(Player& p, int index) {
-    for (int i = index; i < p.cardCount - 1; i++) {
-        p.hand[i] = p.hand[i + 1];
-    }
     p.cardCount--;
+    if (!p.order) {
+        p.hand[index] = p.hand[p.cardCount];
+        return;
+    }
+
+    int pos = p.position[index];
+    for (int i = pos; i < p.cardCount; i++) {
+        p.order[i] = p.order[i + 1];
+        p.position[p.order[i]] = (short)i;
+    }
+    for (int k = p.hand[index].color; k <= WILD; k++) p.groupEnd[k]--;
+
+    if (index == p.cardCount) return;
+    int last = p.position[p.cardCount];
+    p.hand[index] = p.hand[p.cardCount];
+    p.order[last] = (short)index;
+    p.position[index] = (short)last;
 }
 
 bool hasAnyValidMove(const Player& p, const Card& topCard, Color activeColor) {
@@ -102,19 +179,67 @@ bool hasAnyValidMove(const Player& p, const Card& topCard, Color activeColor) {
     return false;
 }
 
-void printPlayerHand(const Player& p) {
+const int CARD_KINDS = 5 * 15; // color * value
+
+int cardKind(const Card& c) {
+    return (int)c.color * 15 + (int)c.value;
+}
+
+// Rebuilds the sorted view from scratch with a counting sort by color, then
+// value; for hands that were filled without addToHand (loads, copies).
+void sortHand(Player& p) {
+    int start[CARD_KINDS + 1];
+    for (int k = 0; k <= CARD_KINDS; k++) start[k] = 0;
+    for (int i = 0; i < p.cardCount; i++) start[cardKind(p.hand[i]) + 1]++;
+    for (int k = 0; k < CARD_KINDS; k++) start[k + 1] += start[k];
+    for (int k = RED; k <= WILD; k++) p.groupEnd[k] = start[(k + 1) * 15];
     for (int i = 0; i < p.cardCount; i++) {
-        cout << "[" << i << "] ";
-        printCard(p.hand[i]);
-        cout << " ";
+        int pos = start[cardKind(p.hand[i])]++;
+        p.order[pos] = (short)i;
+        p.position[i] = (short)pos;
     }
-    cout << "\n";
+}
+
+// Shows the hand in display order, one color group after another; the
+// numbers are display positions. With a top card, playable cards get a '*':
+// the whole group of the active color and the wilds, and in the other
+// groups the cards matching the top card's value.
+void printPlayerHand(ostream& out, const Player& p, const Card* topCard, Color activeColor) {
+    int pos = 0;
+    for (int k = RED; k <= WILD; k++) {
+        if (pos == p.groupEnd[k]) continue;
+        if (pos > 0) out << "| ";
+        bool wholeGroup = topCard && (k == activeColor || k == WILD);
+        for (; pos < p.groupEnd[k]; pos++) {
+            const Card& c = p.hand[p.order[pos]];
+            bool playable = wholeGroup || (topCard && c.value == topCard->value);
+            out << "[" << pos << "] ";
+            printCard(out, c);
+            out << (playable ? "* " : " ");
+        }
+    }
+    out << "\n";
 }
 
 void nextPlayerIndex(int& currentPlayer, int direction, int playersCount) {
     currentPlayer = (currentPlayer + direction + playersCount) % playersCount;
 }
 
+// ---------- Random numbers ----------
+// Every game carries its own generator state (GameState::rng), so a game is
+// reproducible from its seed and simulations can run games on many threads.
+unsigned long long splitMix64(unsigned long long& state) {
+    unsigned long long z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Uniform in [0, n) without the bias of a plain modulo.
+int randomBelow(unsigned long long& state, int n) {
+    return (int)(((splitMix64(state) >> 32) * (unsigned long long)n) >> 32);
+}
+
 // ---------- Deck build & shuffle ----------
 void pushCard(Card deck[], int& deckSize, Color color, Value value) {
     deck[deckSize].color = color;
@@ -157,10 +282,20 @@ void buildUnoDeck(Card deck[], int& deckSize) {
     for (int i = 0; i < 4; i++) pushCard(deck, deckSize, WILD, WILD_PLUS4);
 }
 
+// Several decks shuffled together for large games.
+void buildGameDeck(Card deck[], int& deckSize, int deckCount) {
+    buildUnoDeck(deck, deckSize);
+    for (int d = 1; d < deckCount; d++) {
+        for (int i = 0; i < CARDS_PER_DECK; i++) {
+            deck[deckSize++] = deck[i];
+        }
+    }
+}
+
 // FisherYates shuffle (works everywhere)
-void shuffleDeck(Card deck[], int deckSize) {
+void shuffleDeck(Card deck[], int deckSize, unsigned long long& rng) {
     for (int i = deckSize - 1; i > 0; i--) {
-        int j = rand() % (i + 1);
+        int j = randomBelow(rng, i + 1);
         Card tmp = deck[i];
         deck[i] = deck[j];
         deck[j] = tmp;
@@ -168,46 +303,91 @@ void shuffleDeck(Card deck[], int deckSize) {
 }
 
 // ---------- Discard / Refill / Draw ----------
-bool refillDeckFromDiscard(Card deck[], int& deckSize, Card discard[], int& discardSize) {
-    if (deckSize > 0) return true;
-    if (discardSize == 0) return false;
+Card& pileSlot(GameState& g, int offset) {
+    return g.piles[(g.pileStart + offset) % g.totalCards];
+}
 
-    // move discard -> deck
-    for (int i = 0; i < discardSize; i++) {
-        deck[i] = discard[i];
+// i = 0 is the bottom of the draw pile, deckSize - 1 its top.
+Card& deckCard(GameState& g, int i) {
+    return pileSlot(g, g.deckSize - 1 - i);
+}
+
+// i = 0 is the oldest discarded card.
+Card& discardCard(GameState& g, int i) {
+    return pileSlot(g, g.deckSize + i);
+}
+
+// Fisher-Yates over count ring slots starting at offset.
+void shufflePileRegion(GameState& g, int offset, int count) {
+    for (int i = count - 1; i > 0; i--) {
+        int j = randomBelow(g.rng, i + 1);
+        Card& a = pileSlot(g, offset + i);
+        Card& b = pileSlot(g, offset + j);
+        Card tmp = a;
+        a = b;
+        b = tmp;
     }
-    deckSize = discardSize;
-    discardSize = 0;
+}
+
+void newShuffledDeck(GameState& g) {
+    g.pileStart = 0;
+    g.discardSize = 0;
+    buildGameDeck(g.piles, g.deckSize, g.deckCount);
+    shuffleDeck(g.piles, g.deckSize, g.rng);
+}
+
+// The discard pile already starts where the empty draw pile ends, so a
+// refill only moves the boundary and shuffles the cards where they are.
+bool refillDeckFromDiscard(GameState& g) {
+    if (g.deckSize > 0) return true;
+    if (g.discardSize == 0) return false;
 
-    shuffleDeck(deck, deckSize);
-    cout << "(Deck refilled from discard pile.)\n";
+    g.deckSize = g.discardSize;
+    g.discardSize = 0;
+    g.refills++;
+
+    shufflePileRegion(g, 0, g.deckSize);
+    *g.out << "(Deck refilled from discard pile.)\n";
     return true;
 }
 
-bool drawFromDeck(Card deck[], int& deckSize, Card discard[], int& discardSize, Card& outCard) {
-    if (deckSize == 0) {
-        if (!refillDeckFromDiscard(deck, deckSize, discard, discardSize)) return false;
+bool drawFromDeck(GameState& g, Card& outCard) {
+    if (g.deckSize == 0) {
+        if (!refillDeckFromDiscard(g)) return false;
     }
-    outCard = deck[deckSize - 1];
-    deckSize--;
+    outCard = g.piles[g.pileStart];
+    g.pileStart = (g.pileStart + 1) % g.totalCards;
+    g.deckSize--;
+    g.cardsDrawn++;
     return true;
 }
 
+void logMove(GameState& g, const Card& card) {
+    MoveRecord& m = g.moveLog[g.moveCount % MOVE_LOG_CAPACITY];
+    m.player = (unsigned char)g.currentPlayer;
+    m.card = card;
+    m.chosenColor = g.activeColor;
+    g.moveCount++;
+}
+
 // When a player plays a card: old topCard goes to discard, new card becomes top.
-void playCardFromHand(Player& p, int index, Card discard[], int& discardSize, Card& topCard, Color& activeColor) {
-    discard[discardSize++] = topCard; // old top -> discard
-    topCard = p.hand[index];          // new top
-    if (topCard.color != WILD) activeColor = topCard.color;
+void playCardFromHand(GameState& g, Player& p, int index) {
+    discardCard(g, g.discardSize++) = g.topCard; // old top -> discard
+    g.topCard = p.hand[index];              // new top
+    if (g.topCard.color != WILD) g.activeColor = g.topCard.color;
     removeCard(p, index);
 }
 
 // ---------- Effects ----------
+template <int RULES = RULES_STANDARD>
 CardEffect getCardEffect(const Card& c) {
     CardEffect e;
     e.drawCount = 0;
     e.skipNext = false;
     e.reverseDir = false;
     e.chooseColor = false;
+    e.swapHands = false;
+    e.rotateHands = false;
 
     if (c.color == WILD) {
         e.chooseColor = true;
@@ -228,10 +408,45 @@ CardEffect getCardEffect(const Card& c) {
     else if (c.value == REVERSE) {
         e.reverseDir = true;
     }
+    else if ((RULES & RULE_SEVEN_ZERO) && c.value == SEVEN) {
+        e.swapHands = true;
+    }
+    else if ((RULES & RULE_SEVEN_ZERO) && c.value == ZERO) {
+        e.rotateHands = true;
+    }
 
     return e;
 }
 
+// +2 may be stacked on +2, Wild+4 on any pending draw.
+bool isStackable(const Card& c, const Card& topCard) {
+    if (c.value == WILD_PLUS4) return true;
+    return c.value == PLUS2 && topCard.value == PLUS2;
+}
+
+bool hasStackableCard(const Player& p, const Card& topCard) {
+    for (int i = 0; i < p.cardCount; i++) {
+        if (isStackable(p.hand[i], topCard)) return true;
+    }
+    return false;
+}
+
+bool hasColor(const Player& p, Color color) {
+    for (int i = 0; i < p.cardCount; i++) {
+        if (p.hand[i].color == color) return true;
+    }
+    return false;
+}
+
+// Index of a card identical to topCard (same color and value), or -1.
+int findIdenticalCard(const Player& p, const Card& topCard) {
+    if (topCard.color == WILD) return -1;
+    for (int i = 0; i < p.cardCount; i++) {
+        if (p.hand[i].color == topCard.color && p.hand[i].value == topCard.value) return i;
+    }
+    return -1;
+}
+
 Color askForColorChoice() {
     while (true) {
         cout << "Choose color (R/G/B/Y): ";
@@ -247,14 +462,21 @@ Color askForColorChoice() {
     }
 }
 
-void applyDrawToPlayer(Player& p, Card deck[], int& deckSize, Card discard[], int& discardSize, int count) {
+bool askYesNo(const char* prompt) {
+    cout << prompt << " (y/n): ";
+    char ans;
+    cin >> ans;
+    return ans == 'y' || ans == 'Y';
+}
+
+void applyDrawToPlayer(GameState& g, Player& p, int count) {
     for (int i = 0; i < count; i++) {
         Card drawn;
-        if (drawFromDeck(deck, deckSize, discard, discardSize, drawn)) {
+        if (drawFromDeck(g, drawn)) {
             addToHand(p, drawn);
         }
         else {
-            cout << "No cards left to draw.\n";
+            *g.out << "No cards left to draw.\n";
             return;
         }
     }
@@ -276,421 +498,4066 @@ bool checkUnoDeclaration() {
     return false;
 }
 
-void enforceUnoRuleIfNeeded(Player& p,
-    Card deck[], int& deckSize,
-    Card discard[], int& discardSize) {
+bool declareUno(GameState& g);
+
+void enforceUnoRuleIfNeeded(GameState& g) {
+    Player& p = g.players[g.currentPlayer];
+    ostream& out = *g.out;
     if (p.cardCount == 1) {
-        bool ok = checkUnoDeclaration();
+        bool ok = declareUno(g);
         if (!ok) {
-            cout << "You forgot to declare UNO! Drawing 1 penalty card...\n";
+            out << "You forgot to declare UNO! Drawing 1 penalty card...\n";
+            g.unoPenalties++;
             Card drawn;
-            if (drawFromDeck(deck, deckSize, discard, discardSize, drawn)) {
+            if (drawFromDeck(g, drawn)) {
                 addToHand(p, drawn);
-                cout << "Penalty card: ";
-                printCard(drawn);
-                cout << "\n";
+                out << "Penalty card: ";
+                printCard(out, drawn);
+                out << "\n";
             }
             else {
-                cout << "No cards left to draw.\n";
+                out << "No cards left to draw.\n";
             }
         }
         else {
-            cout << "UNO declared!\n";
+            out << "UNO declared!\n";
         }
     }
 }
 
 // ---------- Save / Load ----------
-void writeCard(ofstream& out, const Card& c) {
+void writeCard(ostream& out, const Card& c) {
     out << (int)c.color << " " << (int)c.value << "\n";
 }
 
-bool readCard(ifstream& in, Card& c) {
+// The ints are range-checked before they narrow into the one-byte enums,
+// so 256 cannot wrap around to a valid red.
+bool readCard(istream& in, Card& c) {
     int col, val;
     if (!(in >> col >> val)) return false;
+    if (col < RED || col > WILD || val < ZERO || val > WILD_PLUS4) return false;
     c.color = (Color)col;
     c.value = (Value)val;
     return true;
 }
 
-bool saveGame(const char* filename,
-    Player players[], int playersCount,
-    int currentPlayer, int direction,
-    const Card& topCard, Color activeColor,
-    Card deck[], int deckSize,
-    Card discard[], int discardSize) {
-    ofstream out(filename);
-    if (!out.is_open()) return false;
+void writeSave(ostream& out, GameState& g) {
+    out << "UNO_SAVE_V4\n";
+    out << g.playersCount << " " << g.deckCount << "\n";
+    out << g.rules << " " << g.pendingDraw << "\n";
+    out << g.seed << " " << g.rng << "\n";
+    out << g.currentPlayer << " " << g.direction << "\n";
+    out << (int)g.activeColor << "\n";
+    writeCard(out, g.topCard);
 
-    out << "UNO_SAVE_V1\n";
-    out << playersCount << "\n";
-    out << currentPlayer << " " << direction << "\n";
-    out << (int)activeColor << "\n";
-    writeCard(out, topCard);
-
-    for (int i = 0; i < playersCount; i++) {
-        out << players[i].cardCount << "\n";
-        for (int j = 0; j < players[i].cardCount; j++) {
-            writeCard(out, players[i].hand[j]);
+    for (int i = 0; i < g.playersCount; i++) {
+        out << g.players[i].cardCount << "\n";
+        for (int j = 0; j < g.players[i].cardCount; j++) {
+            writeCard(out, g.players[i].hand[j]);
         }
     }
 
-    out << deckSize << "\n";
-    for (int i = 0; i < deckSize; i++) {
-        writeCard(out, deck[i]);
+    out << g.deckSize << "\n";
+    for (int i = 0; i < g.deckSize; i++) {
+        writeCard(out, deckCard(g, i));
     }
 
-    out << discardSize << "\n";
-    for (int i = 0; i < discardSize; i++) {
-        writeCard(out, discard[i]);
+    out << g.discardSize << "\n";
+    for (int i = 0; i < g.discardSize; i++) {
+        writeCard(out, discardCard(g, i));
     }
+}
 
-    return true;
+// Writes path.tmp, syncs it and renames it over path, so a crash at any
+// point leaves either the previous save or the new one.
+bool writeSaveFile(const char* path, GameState& g) {
+    char temp[512];
+    if (snprintf(temp, sizeof(temp), "%s.tmp", path) >= (int)sizeof(temp)) return false;
+    FILE* f = fopen(temp, "w");
+    if (!f) return false;
+
+    StdioBuffer buffer(f);
+    ostream out(&buffer);
+    writeSave(out, g);
+    bool ok = out.good() && fflush(f) == 0 && syncFile(f);
+    if (fclose(f) != 0) ok = false;
+    if (ok) ok = replaceFile(temp, path);
+    if (!ok) remove(temp);
+    return ok;
 }
 
-bool loadGame(const char* filename,
-    Player players[], int& playersCount,
-    int& currentPlayer, int& direction,
-    Card& topCard, Color& activeColor,
-    Card deck[], int& deckSize,
-    Card discard[], int& discardSize) {
-    ifstream in(filename);
-    if (!in.is_open()) return false;
+bool saveGame(const char* filename, GameState& g) {
+    return writeSaveFile(filename, g);
+}
 
+// Saves before V4 hold no generator state. They get one derived from the
+// position, so loading the same old save always plays out the same way.
+unsigned long long positionSeed(GameState& g) {
+    unsigned long long h = 0xCBF29CE484222325ULL;
+    for (int i = 0; i < g.playersCount; i++) {
+        for (int j = 0; j < g.players[i].cardCount; j++) h = (h ^ cardKind(g.players[i].hand[j])) * 0x100000001B3ULL;
+        h = (h ^ 0xFF) * 0x100000001B3ULL;
+    }
+    for (int i = 0; i < g.deckSize; i++) h = (h ^ cardKind(deckCard(g, i))) * 0x100000001B3ULL;
+    for (int i = 0; i < g.discardSize; i++) h = (h ^ cardKind(discardCard(g, i))) * 0x100000001B3ULL;
+    return h;
+}
+
+// Reads UNO_SAVE_V1 (4 players, no house rules), V2 (house rules), V3
+// (player count and decks) and V4 (seed and generator state) saves. A V4
+// save resumes with the exact shuffles of the original game. Creates the
+// game from pool; on failure the caller still destroys it.
+bool loadGameFrom(istream& in, GameState& g, ArenaPool& pool) {
     char header[32];
-    in >> header;
-    if (header[0] != 'U') return false; // very simple validation
+    in >> setw(sizeof(header)) >> header;
+    const char* const versions[] = { "UNO_SAVE_V1", "UNO_SAVE_V2", "UNO_SAVE_V3", "UNO_SAVE_V4" };
+    int version = 0;
+    for (int v = 0; v < 4 && !version; v++) {
+        if (strcmp(header, versions[v]) == 0) version = v + 1;
+    }
+    if (!version) return false;
 
+    int playersCount, deckCount = 1;
     if (!(in >> playersCount)) return false;
+    if (version >= 3 && !(in >> deckCount)) return false;
     if (playersCount < MIN_PLAYERS || playersCount > MAX_PLAYERS) return false;
+    if (deckCount < 1 || deckCount > MAX_DECKS) return false;
+
+    int rules = RULES_STANDARD, pendingDraw = 0;
+    if (version >= 2) {
+        if (!(in >> rules >> pendingDraw)) return false;
+        if (rules < 0 || rules >= RULE_COMBINATIONS) return false;
+    }
+
+    unsigned long long seed = 0, rng = 0;
+    if (version >= 4 && !(in >> seed >> rng)) return false;
+
+    if (!createGame(g, pool, playersCount, deckCount, rules)) return false;
+    setRender(g, false); // the hands are sorted once their cards are checked
+    g.seed = seed;
+    g.rng = rng;
+    g.pendingDraw = pendingDraw;
+    if (g.pendingDraw < 0 || g.pendingDraw > g.totalCards) return false;
 
-    if (!(in >> currentPlayer >> direction)) return false;
+    if (!(in >> g.currentPlayer >> g.direction)) return false;
 
     int ac;
-    if (!(in >> ac)) return false;
-    activeColor = (Color)ac;
+    if (!(in >> ac) || ac < RED || ac >= WILD) return false;
+    g.activeColor = (Color)ac;
 
-    if (!readCard(in, topCard)) return false;
+    if (!readCard(in, g.topCard)) return false;
 
-    for (int i = 0; i < playersCount; i++) {
-        if (!(in >> players[i].cardCount)) return false;
-        if (players[i].cardCount < 0 || players[i].cardCount > TOTAL_CARDS) return false;
-        for (int j = 0; j < players[i].cardCount; j++) {
-            if (!readCard(in, players[i].hand[j])) return false;
+    for (int i = 0; i < g.playersCount; i++) {
+        if (!(in >> g.players[i].cardCount)) return false;
+        if (g.players[i].cardCount < 0 || g.players[i].cardCount > g.totalCards) return false;
+        for (int j = 0; j < g.players[i].cardCount; j++) {
+            if (!readCard(in, g.players[i].hand[j])) return false;
         }
     }
 
-    if (!(in >> deckSize)) return false;
-    if (deckSize < 0 || deckSize > TOTAL_CARDS) return false;
-    for (int i = 0; i < deckSize; i++) {
-        if (!readCard(in, deck[i])) return false;
+    g.pileStart = 0;
+    if (!(in >> g.deckSize)) return false;
+    if (g.deckSize < 0 || g.deckSize > g.totalCards) return false;
+    for (int i = 0; i < g.deckSize; i++) {
+        if (!readCard(in, deckCard(g, i))) return false;
     }
 
-    if (!(in >> discardSize)) return false;
-    if (discardSize < 0 || discardSize > TOTAL_CARDS) return false;
-    for (int i = 0; i < discardSize; i++) {
-        if (!readCard(in, discard[i])) return false;
+    if (!(in >> g.discardSize)) return false;
+    if (g.discardSize < 0 || g.deckSize + g.discardSize > g.totalCards) return false;
+    for (int i = 0; i < g.discardSize; i++) {
+        if (!readCard(in, discardCard(g, i))) return false;
     }
 
-    if (currentPlayer < 0 || currentPlayer >= playersCount) currentPlayer = 0;
-    if (!(direction == 1 || direction == -1)) direction = 1;
+    if (g.currentPlayer < 0 || g.currentPlayer >= g.playersCount) g.currentPlayer = 0;
+    if (!(g.direction == 1 || g.direction == -1)) g.direction = 1;
 
+    // Older versions dropped wilds turned up as the first card, so saves
+    // may hold fewer cards than the decks, but never more or invalid ones.
+    int cards = 1 + g.deckSize + g.discardSize;
+    for (int i = 0; i < g.playersCount; i++) cards += g.players[i].cardCount;
+    g.missingCards = g.totalCards - cards;
+    if (checkGameInvariants(g, true)) return false;
+    setRender(g, true);
+    if (version < 4) g.seed = g.rng = positionSeed(g);
     return true;
 }
 
+bool loadGame(const char* filename, GameState& g, ArenaPool& pool) {
+    ifstream in(filename);
+    if (!in.is_open()) return false;
+    return loadGameFrom(in, g, pool);
+}
+
 // ---------- Game setup ----------
-void initPlayers(Player players[], int playersCount) {
+int gameArenaBytes(int playersCount, int totalCards) {
+    int bytes = 0;
+    bytes += playersCount * (int)sizeof(Player) + 8;
+    bytes += (playersCount + 1) * (totalCards * (int)sizeof(Card) + 8);
+    bytes += MOVE_LOG_CAPACITY * (int)sizeof(MoveRecord) + 8;
+    bytes += totalCards * (int)sizeof(int) + 8;
+    bytes += 2 * playersCount * totalCards * (int)sizeof(short) + 8;
+    return bytes;
+}
+
+// Shown games keep every hand's sorted view up to date; silent games skip
+// that work. The views belong to the hands (the 7-0 rule moves them along),
+// so turning them on hands out fresh ones seat by seat.
+void setRender(GameState& g, bool render) {
+    g.render = render;
+    for (int i = 0; i < g.playersCount; i++) {
+        Player& p = g.players[i];
+        p.order = render ? g.handViews + 2 * i * g.totalCards : 0;
+        p.position = render ? p.order + g.totalCards : 0;
+        if (render) sortHand(p);
+    }
+}
+
+// The players, one hand per player, the shared pile ring, the move log,
+// the bots' scratch space and the hands' sorted views all come from one
+// arena. Every hand has room for every card in play, like the pile ring, so
+// nothing can overflow. That makes the arena players x cards in play (about
+// 26 KB at 10 players and 3 decks), on purpose: one hand can take almost the
+// whole deck through stacked draws, and the 7-0 rule swaps hands between
+// seats, so a tighter bound per seat would need a check on every draw.
+// Arenas go back to the pool, so a batch pays for them once per slot in
+// flight, not once per game. The sorted views hold shorts, as a hand slot
+// is always below MAX_DECKS * CARDS_PER_DECK.
+bool createGame(GameState& g, ArenaPool& pool, int playersCount, int deckCount, int rules) {
+    if (playersCount < MIN_PLAYERS || playersCount > MAX_PLAYERS) return false;
+    if (deckCount < 1 || deckCount > MAX_DECKS) return false;
+
+    int totalCards = deckCount * CARDS_PER_DECK;
+    Arena* arena = acquireArena(pool, gameArenaBytes(playersCount, totalCards));
+
+    g.arena = arena;
+    g.deckCount = deckCount;
+    g.totalCards = totalCards;
+    g.rules = rules;
+    g.pendingDraw = 0;
+    g.turnStage = STAGE_JUMP_IN;
+
+    g.players = (Player*)arenaAlloc(*arena, playersCount * (int)sizeof(Player));
+    g.playersCount = playersCount;
     for (int i = 0; i < playersCount; i++) {
-        players[i].cardCount = 0;
+        g.players[i].hand = (Card*)arenaAlloc(*arena, totalCards * (int)sizeof(Card));
+        g.players[i].cardCount = 0;
+        g.players[i].order = 0;
+        g.players[i].position = 0;
+        g.players[i].agent = AGENT_HUMAN;
+        g.players[i].weights = &DEFAULT_BOT_WEIGHTS;
     }
+
+    g.piles = (Card*)arenaAlloc(*arena, totalCards * (int)sizeof(Card));
+    g.pileStart = 0;
+    g.deckSize = 0;
+    g.discardSize = 0;
+
+    g.moveLog = (MoveRecord*)arenaAlloc(*arena, MOVE_LOG_CAPACITY * (int)sizeof(MoveRecord));
+    g.moveCount = 0;
+
+    g.agentScratch = (int*)arenaAlloc(*arena, totalCards * (int)sizeof(int));
+    g.handViews = (short*)arenaAlloc(*arena, 2 * playersCount * totalCards * (int)sizeof(short));
+
+    g.solver = 0;
+    g.book = 0;
+    g.plannedColor = -1;
+    g.remoteMove.choice = -2;
+    g.remoteMove.color = -1;
+    g.remoteMove.swapTarget = -1;
+    g.remoteMove.uno = false;
+    g.out = &cout;
+    g.winner = -1;
+    g.seed = 0;
+    g.rng = 0;
+    g.turns = 0;
+    g.refills = 0;
+    g.cardsDrawn = 0;
+    g.actionCardsPlayed = 0;
+    g.unoPenalties = 0;
+    g.turnLog = 0;
+    g.autosave = 0;
+    g.spectators = 0;
+    g.metrics = 0;
+    g.missingCards = 0;
+    g.checkInvariants = false;
+    g.turnLimit = 0;
+    g.decisionBytes = 0;
+    g.decisionBytesLeft = 0;
+    g.currentPlayer = 0;
+    g.direction = 1;
+    setRender(g, true);
+    return true;
+}
+
+void seedGame(GameState& g, unsigned long long seed) {
+    g.seed = seed;
+    g.rng = seed;
+}
+
+void destroyGame(GameState& g, ArenaPool& pool) {
+    if (g.arena) releaseArena(pool, g.arena);
+    g.arena = 0;
+    g.players = 0;
+    g.piles = 0;
+    g.moveLog = 0;
+    g.agentScratch = 0;
+    g.handViews = 0;
 }
 
-void dealInitialCards(Player players[], int playersCount,
-    Card deck[], int& deckSize,
-    Card discard[], int& discardSize) {
+void dealInitialCards(GameState& g) {
     for (int r = 0; r < 7; r++) {
-        for (int p = 0; p < playersCount; p++) {
+        for (int p = 0; p < g.playersCount; p++) {
             Card c;
-            if (drawFromDeck(deck, deckSize, discard, discardSize, c)) {
-                addToHand(players[p], c);
+            if (drawFromDeck(g, c)) {
+                addToHand(g.players[p], c);
             }
         }
     }
 }
 
-void startTopCard(Card deck[], int& deckSize,
-    Card discard[], int& discardSize,
-    Card& topCard, Color& activeColor) {
+void startTopCard(GameState& g) {
     Card c;
-    while (drawFromDeck(deck, deckSize, discard, discardSize, c)) {
+    while (drawFromDeck(g, c)) {
         if (c.color != WILD) {
-            topCard = c;
-            activeColor = c.color;
+            g.topCard = c;
+            g.activeColor = c.color;
             return;
         }
-        // If wild at start, ignore it for simplicity.
-        // (Alternative: put it in discard and draw another)
+        // A wild can't start the game: it goes to the discard pile.
+        discardCard(g, g.discardSize++) = c;
     }
     // fallback
-    topCard.color = RED;
-    topCard.value = ZERO;
-    activeColor = RED;
+    g.topCard.color = RED;
+    g.topCard.value = ZERO;
+    g.activeColor = RED;
 }
 
-// ---------- Game loop ----------
-void runGameLoop(Player players[], int playersCount,
-    Card deck[], int& deckSize,
-    Card discard[], int& discardSize,
-    Card& topCard, Color& activeColor,
-    int& currentPlayer, int& direction) {
-    while (true) {
-        Player& p = players[currentPlayer];
-
-        cout << "\n--- UNO ---\n";
-        cout << "Current card: ";
-        printCard(topCard);
-        cout << "\n";
+// ---------- Autosave ----------
+// Every few turns the game thread copies the game into one of two snapshot
+// slots and carries on; a writer thread saves the snapshot with
+// writeSaveFile, so a crash loses at most the turns since the last save.
+// Each slot changes hands through one atomic state: the game thread never
+// waits for the writer or the disk, and a snapshot the writer has not
+// picked up yet is simply replaced by a newer one.
+//
+// Autosaves go to a file of their own, so starting a new game never
+// overwrites the player's manual save. The file is removed once the game
+// ends or is saved by hand; one that is still there belongs to a game that
+// was cut short, and Continue Game offers it.
+const char* const AUTOSAVE_FILE = "autosave.txt";
+const int AUTOSAVE_INTERVAL = 5;  // turns between autosaves by default
+const int AUTOSAVE_POLL_MS = 20;  // writer's sleep while there is nothing to save
 
-        cout << "Player " << (currentPlayer + 1) << " - Your cards:\n";
-        printPlayerHand(p);
+enum SnapshotState { SNAPSHOT_FREE, SNAPSHOT_FILLING, SNAPSHOT_READY, SNAPSHOT_WRITING };
 
-        // Win check (should happen right after play, but safe here too)
-        if (p.cardCount == 0) {
-            cout << "Player " << (currentPlayer + 1) << " wins!\n";
-            return;
-        }
+struct Autosave {
+    const char* path;
+    int interval;
+    GameState snapshots[2];
+    atomic<int> state[2];
+    atomic<bool> stopping;
+    atomic<int> saves;
+    atomic<int> failures;
+    Metrics* metrics;   // times the writes, may be null
+    thread writer;
+};
 
-        // If no valid move -> draw 1 and optionally play it
-        if (!hasAnyValidMove(p, topCard, activeColor)) {
-            cout << "No suitable cards. Automatically drawing 1 card...\n";
+// Copies what a save holds into dst, a game with the same players and decks.
+void copySaveState(GameState& dst, const GameState& src) {
+    dst.pendingDraw = src.pendingDraw;
+    dst.currentPlayer = src.currentPlayer;
+    dst.direction = src.direction;
+    dst.activeColor = src.activeColor;
+    dst.topCard = src.topCard;
+    for (int i = 0; i < src.playersCount; i++) {
+        dst.players[i].cardCount = src.players[i].cardCount;
+        memcpy(dst.players[i].hand, src.players[i].hand, src.players[i].cardCount * sizeof(Card));
+        if (dst.players[i].order) sortHand(dst.players[i]);
+    }
+    memcpy(dst.piles, src.piles, src.totalCards * sizeof(Card));
+    dst.pileStart = src.pileStart;
+    dst.deckSize = src.deckSize;
+    dst.discardSize = src.discardSize;
+    dst.turns = src.turns;
+    dst.seed = src.seed;
+    dst.rng = src.rng;
+}
 
-            Card drawn;
-            if (!drawFromDeck(deck, deckSize, discard, discardSize, drawn)) {
-                cout << "No cards left to draw.\n";
-                return;
-            }
+void runAutosaveWriter(Autosave* a) {
+    while (true) {
+        // Read before looking at the slots, so a snapshot pushed before
+        // stopping is still written.
+        bool stopping = a->stopping.load(memory_order_acquire);
+        bool wrote = false;
+        for (int i = 0; i < 2; i++) {
+            int expected = SNAPSHOT_READY;
+            if (!a->state[i].compare_exchange_strong(expected, SNAPSHOT_WRITING, memory_order_acquire)) continue;
+            long long start = metricsClock();
+            if (writeSaveFile(a->path, a->snapshots[i])) a->saves++;
+            else a->failures++;
+            if (a->metrics) recordLatency(*a->metrics, LATENCY_SAVE, metricsClock() - start);
+            a->state[i].store(SNAPSHOT_FREE, memory_order_release);
+            wrote = true;
+        }
+        if (wrote) continue;
+        if (stopping) return;
+        this_thread::sleep_for(chrono::milliseconds(AUTOSAVE_POLL_MS));
+    }
+}
 
-            cout << "Drawn card: ";
-            printCard(drawn);
-            cout << "\n";
+// Snapshots are shaped like g and come from pool. Starts the writer.
+Autosave* createAutosave(const GameState& g, ArenaPool& pool, const char* path, int interval) {
+    Autosave* a = new Autosave();
+    a->path = path;
+    a->interval = interval;
+    for (int i = 0; i < 2; i++) {
+        a->snapshots[i] = GameState();
+        createGame(a->snapshots[i], pool, g.playersCount, g.deckCount, g.rules);
+        setRender(a->snapshots[i], false);
+        a->state[i].store(SNAPSHOT_FREE);
+    }
+    a->stopping.store(false);
+    a->saves.store(0);
+    a->failures.store(0);
+    a->metrics = g.metrics;
+    a->writer = thread(runAutosaveWriter, a);
+    return a;
+}
 
-            addToHand(p, drawn);
+// Called by the game thread at the start of a turn. Takes the slot the
+// writer is not using, preferring one whose snapshot is still waiting.
+void pushAutosave(Autosave& a, const GameState& g) {
+    int slot = -1;
+    for (int i = 0; i < 2 && slot < 0; i++) {
+        int expected = SNAPSHOT_READY;
+        if (a.state[i].compare_exchange_strong(expected, SNAPSHOT_FILLING, memory_order_acquire)) slot = i;
+    }
+    for (int i = 0; i < 2 && slot < 0; i++) {
+        int expected = SNAPSHOT_FREE;
+        if (a.state[i].compare_exchange_strong(expected, SNAPSHOT_FILLING, memory_order_acquire)) slot = i;
+    }
+    if (slot < 0) return; // the writer holds at most one slot, so this does not happen
 
-            if (isValidMove(drawn, topCard, activeColor)) {
-                cout << "You can play the drawn card. Play it now? (y/n): ";
-                char ans;
-                cin >> ans;
-
-                if (ans == 'y' || ans == 'Y') {
-                    int idx = p.cardCount - 1; // last card
-
-                    CardEffect eff = getCardEffect(p.hand[idx]);
-
-                    cout << "> You used ";
-                    printCard(p.hand[idx]);
-                    cout << "\n";
-
-                    playCardFromHand(p, idx, discard, discardSize, topCard, activeColor);
-
-                    if (eff.chooseColor) {
-                        activeColor = askForColorChoice();
-                    }
-
-                    // UNO
-                    enforceUnoRuleIfNeeded(p, deck, deckSize, discard, discardSize);
-
-                    // Win
-                    if (p.cardCount == 0) {
-                        cout << "Player " << (currentPlayer + 1) << " wins!\n";
-                        return;
-                    }
-
-                    // Reverse with 2 players = Skip
-                    if (eff.reverseDir && playersCount == 2) {
-                        eff.reverseDir = false;
-                        eff.skipNext = true;
-                    }
-
-                    if (eff.reverseDir) direction *= -1;
-
-                    // Apply effects to next player immediately
-                    if (eff.drawCount > 0 || eff.skipNext) {
-                        nextPlayerIndex(currentPlayer, direction, playersCount);
-                        Player& nextP = players[currentPlayer];
-
-                        if (eff.drawCount > 0) {
-                            cout << "Player " << (currentPlayer + 1) << " draws " << eff.drawCount << " cards.\n";
-                            applyDrawToPlayer(nextP, deck, deckSize, discard, discardSize, eff.drawCount);
-                        }
-                        if (eff.skipNext) {
-                            cout << "Player " << (currentPlayer + 1) << " is skipped.\n";
-                            nextPlayerIndex(currentPlayer, direction, playersCount);
-                        }
-                    }
-                    else {
-                        nextPlayerIndex(currentPlayer, direction, playersCount);
-                    }
-
-                    continue; // turn finished
-                }
-            }
+    copySaveState(a.snapshots[slot], g);
+    a.state[slot].store(SNAPSHOT_READY, memory_order_release);
+}
 
-            // If not played, next player
-            nextPlayerIndex(currentPlayer, direction, playersCount);
-            continue;
+// Stops the writer once it has written the snapshot still waiting, or
+// drops that snapshot when flush is false (e.g. before a manual save,
+// which it must not overwrite).
+void stopAutosave(Autosave& a, bool flush) {
+    if (!a.writer.joinable()) return;
+    if (!flush) {
+        for (int i = 0; i < 2; i++) {
+            int expected = SNAPSHOT_READY;
+            a.state[i].compare_exchange_strong(expected, SNAPSHOT_FREE, memory_order_acquire);
         }
+    }
+    a.stopping.store(true, memory_order_release);
+    a.writer.join();
+}
 
-        // Normal play: choose a card index
-        cout << "Choose card index to play (or -1 to Save & Exit): ";
-        int choice;
-        cin >> choice;
+void destroyAutosave(Autosave* a, ArenaPool& pool) {
+    stopAutosave(*a, true);
+    for (int i = 0; i < 2; i++) destroyGame(a->snapshots[i], pool);
+    delete a;
+}
 
-        if (choice == -1) {
-            bool ok = saveGame("save.txt",
-                players, playersCount,
-                currentPlayer, direction,
-                topCard, activeColor,
-                deck, deckSize,
-                discard, discardSize);
-            if (ok) cout << "Game saved to save.txt\n";
-            else cout << "Failed to save game.\n";
-            return;
-        }
+// ---------- Invariants ----------
+const int INVARIANT_SCAN_INTERVAL = 8; // turns between full card scans in checked games
 
-        if (choice < 0 || choice >= p.cardCount || !isValidMove(p.hand[choice], topCard, activeColor)) {
-            cout << "Invalid move. Try again.\n";
-            continue; // same player again
-        }
+int copiesPerDeck(const Card& c) {
+    if (c.color == WILD) return 4;
+    return c.value == ZERO ? 1 : 2;
+}
 
-        CardEffect eff = getCardEffect(p.hand[choice]);
+bool isValidCard(const Card& c) {
+    if (c.color > WILD || c.value > WILD_PLUS4) return false;
+    return (c.color == WILD) == (c.value >= WILD_CARD);
+}
 
-        cout << "> You used ";
-        printCard(p.hand[choice]);
-        cout << "\n";
+// Counts count cards by kind. Returns false on an invalid card.
+bool countCards(const Card cards[], int count, int kindCounts[]) {
+    for (int i = 0; i < count; i++) {
+        if (!isValidCard(cards[i])) return false;
+        kindCounts[cardKind(cards[i])]++;
+    }
+    return true;
+}
+
+// Consistency check of a game. Returns a description of the first problem
+// found, or 0. Every card of the decks must be in a hand, a pile or on top,
+// except the ones an old save was already missing. The structural checks are
+// O(players); scanCards also validates every card and the copies of each.
+const char* checkGameInvariants(const GameState& g, bool scanCards) {
+    if (g.playersCount < MIN_PLAYERS || g.playersCount > MAX_PLAYERS) return "player count out of range";
+    if (g.deckCount < 1 || g.deckCount > MAX_DECKS) return "deck count out of range";
+    if (g.totalCards != g.deckCount * CARDS_PER_DECK) return "total cards do not match the decks";
+    if (g.currentPlayer < 0 || g.currentPlayer >= g.playersCount) return "current player out of range";
+    if (g.direction != 1 && g.direction != -1) return "invalid direction";
+    if (g.rules < 0 || g.rules >= RULE_COMBINATIONS) return "invalid house rules";
+    if (g.pendingDraw < 0 || g.pendingDraw > g.totalCards) return "pending draw out of range";
+    if (g.pendingDraw > 0 && !(g.rules & RULE_STACKING)) return "pending draw without stacking";
+    if (g.activeColor >= WILD) return "invalid active color";
+    if (!isValidCard(g.topCard)) return "invalid top card";
+    if (g.topCard.color != WILD && g.topCard.color != g.activeColor) return "active color differs from the top card";
 
-        playCardFromHand(p, choice, discard, discardSize, topCard, activeColor);
+    int cards = 1;
+    for (int i = 0; i < g.playersCount; i++) {
+        if (g.players[i].cardCount < 0 || g.players[i].cardCount > g.totalCards) return "hand size out of range";
+        cards += g.players[i].cardCount;
+    }
+    if (g.deckSize < 0 || g.discardSize < 0) return "negative pile size";
+    if (g.pileStart < 0 || g.pileStart >= g.totalCards) return "pile start out of range";
+    cards += g.deckSize + g.discardSize;
+    if (cards > g.totalCards || g.missingCards < 0) return "more cards than the decks hold";
+    if (cards + g.missingCards != g.totalCards) return "cards lost";
+    if (!scanCards) return 0;
 
-        if (eff.chooseColor) {
-            activeColor = askForColorChoice();
+    int kindCounts[CARD_KINDS];
+    memset(kindCounts, 0, sizeof(kindCounts));
+    kindCounts[cardKind(g.topCard)]++;
+    for (int i = 0; i < g.playersCount; i++) {
+        const Player& p = g.players[i];
+        if (!countCards(p.hand, p.cardCount, kindCounts)) return "invalid card in a hand";
+        if (!p.order) continue;
+        if (p.groupEnd[WILD] != p.cardCount) return "sorted hand out of date";
+        for (int pos = 0; pos < p.cardCount; pos++) {
+            int slot = p.order[pos];
+            if (slot < 0 || slot >= p.cardCount || p.position[slot] != pos) return "sorted hand out of date";
+            const Card& c = p.hand[slot];
+            if (pos >= p.groupEnd[c.color] || (c.color > RED && pos < p.groupEnd[c.color - 1])) return "card outside its color group";
+            if (pos > 0 && cardKind(p.hand[p.order[pos - 1]]) > cardKind(c)) return "hand not sorted";
         }
+    }
+    // The piles are one ring: at most two contiguous runs.
+    int pileCards = g.deckSize + g.discardSize;
+    int firstRun = g.totalCards - g.pileStart < pileCards ? g.totalCards - g.pileStart : pileCards;
+    if (!countCards(g.piles + g.pileStart, firstRun, kindCounts) ||
+        !countCards(g.piles, pileCards - firstRun, kindCounts)) return "invalid card in a pile";
 
-        // UNO
-        enforceUnoRuleIfNeeded(p, deck, deckSize, discard, discardSize);
+    for (int k = 0; k < CARD_KINDS; k++) {
+        if (kindCounts[k] == 0) continue;
+        Card c;
+        c.color = (Color)(k / 15);
+        c.value = (Value)(k % 15);
+        if (kindCounts[k] > copiesPerDeck(c) * g.deckCount) return "duplicated card";
+    }
+    return 0;
+}
 
-        // Win
-        if (p.cardCount == 0) {
-            cout << "Player " << (currentPlayer + 1) << " wins!\n";
-            return;
-        }
+// ---------- Win model ----------
+// Static estimate of each player's chance to win, for search to score
+// positions it does not play out. Every seat gets a score w . x from a few
+// features of its hand and position, and the win probabilities are the
+// softmax of the scores (a conditional logit), so for two players
+// P(first wins) = 1 / (1 + e^(s1 - s0)). Features are floats in a fixed,
+// padded array; a score is one short multiply-add loop the compiler
+// vectorizes. The weights are fitted by --fit-model and read from a file.
+const char* const MODEL_FEATURE_NAMES[MODEL_FEATURES] = {
+    "cards", "one_card", "two_cards", "wilds", "plus4s", "actions",
+    "active_color", "largest_color", "colors", "to_move", "seats_away", "cards_by_pile"
+};
 
-        // Reverse with 2 players = Skip
-        if (eff.reverseDir && playersCount == 2) {
-            eff.reverseDir = false;
-            eff.skipNext = true;
-        }
+// Features of one seat: its hand, how many turns until it moves (0 for the
+// player to move) and the size of the table and the draw pile.
+void modelFeatures(const Card hand[], int count, Color activeColor, int seatsAway, int playersCount,
+    int pileSize, int totalCards, float x[]) {
+    int colorCounts[5] = { 0, 0, 0, 0, 0 };
+    int wilds = 0, plus4s = 0, actions = 0;
+    for (int i = 0; i < count; i++) {
+        const Card& c = hand[i];
+        colorCounts[c.color]++;
+        if (c.value == WILD_CARD) wilds++;
+        else if (c.value == WILD_PLUS4) plus4s++;
+        else if (c.value > NINE) actions++;
+    }
+    int largest = 0, colors = 0;
+    for (int c = 0; c < 4; c++) {
+        if (colorCounts[c] > largest) largest = colorCounts[c];
+        if (colorCounts[c] > 0) colors++;
+    }
 
-        if (eff.reverseDir) direction *= -1;
+    x[F_CARDS] = count / 10.0f;
+    x[F_ONE_CARD] = count == 1 ? 1.0f : 0.0f;
+    x[F_TWO_CARDS] = count == 2 ? 1.0f : 0.0f;
+    x[F_WILDS] = (float)wilds;
+    x[F_PLUS4S] = (float)plus4s;
+    x[F_ACTIONS] = (float)actions;
+    x[F_ACTIVE_COLOR] = activeColor < WILD ? colorCounts[activeColor] / 10.0f : 0.0f;
+    x[F_LARGEST_COLOR] = largest / 10.0f;
+    x[F_COLORS] = colors / 4.0f;
+    x[F_TO_MOVE] = seatsAway == 0 ? 1.0f : 0.0f;
+    x[F_SEATS_AWAY] = (float)seatsAway / playersCount;
+    x[F_CARDS_BY_PILE] = x[F_CARDS] * pileSize / totalCards;
+}
 
-        // Apply effects to next player immediately
-        if (eff.drawCount > 0 || eff.skipNext) {
-            nextPlayerIndex(currentPlayer, direction, playersCount);
-            Player& nextP = players[currentPlayer];
+float modelScore(const WinModel& m, const float x[]) {
+    float s = 0;
+    for (int k = 0; k < MODEL_FEATURES; k++) s += m.w[k] * x[k];
+    return s;
+}
 
-            if (eff.drawCount > 0) {
-                cout << "Player " << (currentPlayer + 1) << " draws " << eff.drawCount << " cards.\n";
-                applyDrawToPlayer(nextP, deck, deckSize, discard, discardSize, eff.drawCount);
-            }
-            if (eff.skipNext) {
-                cout << "Player " << (currentPlayer + 1) << " is skipped.\n";
-                nextPlayerIndex(currentPlayer, direction, playersCount);
-            }
-        }
-        else {
-            nextPlayerIndex(currentPlayer, direction, playersCount);
-        }
+// Features of every seat of g, seat i at x + i * MODEL_FEATURES.
+void gameModelFeatures(const GameState& g, float x[]) {
+    for (int i = 0; i < g.playersCount; i++) {
+        int away = (i - g.currentPlayer) * g.direction;
+        away = ((away % g.playersCount) + g.playersCount) % g.playersCount;
+        const Player& p = g.players[i];
+        modelFeatures(p.hand, p.cardCount, g.activeColor, away, g.playersCount, g.deckSize, g.totalCards,
+            x + i * MODEL_FEATURES);
     }
 }
 
-// ---------- Menu helpers ----------
-int readMenuChoice() {
-    cout << "--- UNO ---\n";
-    cout << "[1] New Game\n";
-    cout << "[2] Continue Game\n";
-    cout << "[3] Exit\n";
-    cout << "Choose: ";
-    int c;
-    cin >> c;
-    return c;
+// Softmax of the seat scores into probabilities[].
+void modelProbabilities(const WinModel& m, const float x[], int players, double probabilities[]) {
+    double top = 0;
+    for (int i = 0; i < players; i++) {
+        probabilities[i] = modelScore(m, x + i * MODEL_FEATURES);
+        if (i == 0 || probabilities[i] > top) top = probabilities[i];
+    }
+    double sum = 0;
+    for (int i = 0; i < players; i++) {
+        probabilities[i] = exp(probabilities[i] - top);
+        sum += probabilities[i];
+    }
+    for (int i = 0; i < players; i++) probabilities[i] /= sum;
 }
 
-int readPlayersCount() {
-    int playersCount;
-    while (true) {
-        cout << "Enter number of players (2-4): ";
-        cin >> playersCount;
-        if (playersCount >= MIN_PLAYERS && playersCount <= MAX_PLAYERS) return playersCount;
-        cout << "Invalid number of players.\n";
+// Each player's estimated chance to win g.
+void estimateWinProbabilities(const WinModel& m, const GameState& g, double probabilities[]) {
+    float x[MAX_PLAYERS * MODEL_FEATURES];
+    gameModelFeatures(g, x);
+    modelProbabilities(m, x, g.playersCount, probabilities);
+}
+
+// Text file: a header, the table size, then one "name weight" per feature.
+bool writeWinModel(const char* path, const WinModel& m) {
+    char temp[512];
+    if (snprintf(temp, sizeof(temp), "%s.tmp", path) >= (int)sizeof(temp)) return false;
+    FILE* f = fopen(temp, "w");
+    if (!f) return false;
+
+    StdioBuffer buffer(f);
+    ostream out(&buffer);
+    out << "UNO_MODEL_V1\n" << m.playersCount << "\n" << setprecision(9);
+    for (int k = 0; k < MODEL_FEATURES; k++) out << MODEL_FEATURE_NAMES[k] << " " << m.w[k] << "\n";
+    bool ok = out.good() && fflush(f) == 0 && syncFile(f);
+    if (fclose(f) != 0) ok = false;
+    if (ok) ok = replaceFile(temp, path);
+    if (!ok) remove(temp);
+    return ok;
+}
+
+bool readWinModel(const char* path, WinModel& m) {
+    ifstream in(path);
+    char word[32];
+    if (!(in >> setw(sizeof(word)) >> word) || strcmp(word, "UNO_MODEL_V1") != 0) return false;
+    if (!(in >> m.playersCount) || m.playersCount < MIN_PLAYERS || m.playersCount > MAX_PLAYERS) return false;
+    for (int k = 0; k < MODEL_FEATURES; k++) {
+        if (!(in >> setw(sizeof(word)) >> word >> m.w[k])) return false;
+        if (strcmp(word, MODEL_FEATURE_NAMES[k]) != 0 || !isfinite(m.w[k])) return false;
     }
+    return true;
 }
 
-// ---------- main ----------
-int main() {
-    srand((unsigned)time(0));
+// ---------- Endgame solver ----------
+// Exact solver for two-player standard-rules endgames where every card that
+// can still matter is known: both hands and the order of the draw pile. The
+// game is then deterministic, so a negamax search with alpha-beta and a
+// transposition table finds the result. Every move either plays a card or
+// draws from the known pile, so the search always terminates. Lines that
+// draw past the end of the pile (a refill would shuffle) or past
+// SOLVER_MAX_DRAWS cards, or grow a hand past SOLVER_MAX_HAND, count as
+// unresolved. Values are in units of SOLVER_WIN; with a win model, an
+// unresolved line is scored by its estimate of the position the line
+// reaches instead of as a draw.
+const int SOLVER_MAX_HAND = 8;             // larger hands during the search are unresolved
+const int SOLVER_SHORT_HAND = 3;           // a hand this small makes a position an endgame
+const int SOLVER_MAX_DRAWS = 12;           // known pile cards the search may consume
+const int SOLVER_TABLE_BITS = 16;
+const int SOLVER_TABLE_SIZE = 1 << SOLVER_TABLE_BITS;
+const int SOLVER_NODE_BUDGET = 20000;
+const int SOLVER_WIN = 100;                // value of a won line; estimates stay strictly inside
 
-    Player players[MAX_PLAYERS];
-    int playersCount = 0;
+const unsigned char BOUND_EXACT = 1;
+const unsigned char BOUND_LOWER = 2;
+const unsigned char BOUND_UPPER = 3;
 
-    Card deck[TOTAL_CARDS];
-    int deckSize = 0;
+struct SolverEntry {
+    unsigned long long key;
+    signed char value;
+    unsigned char bound;
+    unsigned char generation;
+};
+
+struct EndgameSolver {
+    SolverEntry* table;
+    unsigned char generation;
+    int nodes;
+    int nodeBudget;
+    bool aborted;
+    const WinModel* model; // scores unresolved lines, may be null
+    int pileSize;          // the real draw pile, for the model
+    int totalCards;
 
-    Card discard[TOTAL_CARDS];
-    int discardSize = 0;
+    Card deck[SOLVER_MAX_DRAWS]; // known draw order, next card first
+    int deckSize;
+
+    unsigned long long cardKeys[2][CARD_KINDS];
+    unsigned long long topKeys[CARD_KINDS];
+    unsigned long long colorKeys[5];
+    unsigned long long moverKey;
+};
 
+struct SolverPosition {
+    Card hand[2][SOLVER_MAX_HAND];
+    int count[2];
     Card topCard;
-    Color activeColor = RED;
+    Color activeColor;
+    int toMove;
+    int deckPos;    // cards already drawn from the known pile
+};
 
-    int currentPlayer = 0;
-    int direction = 1;
+// A play of hand[index] (or of the card just drawn when index == -1 and
+// playDrawn is set). color only matters for wild cards.
+struct SolverMove {
+    int index;
+    bool playDrawn;
+    Color color;
+};
 
-    int menu = readMenuChoice();
-    if (menu == 3) return 0;
+struct EndgameResult {
+    int score;          // +/-SOLVER_WIN the player to move wins / loses, else unresolved (0 or an estimate)
+    SolverMove best;
+    int nodes;
+};
 
-    if (menu == 2) {
-        bool ok = loadGame("save.txt",
-            players, playersCount,
-            currentPlayer, direction,
-            topCard, activeColor,
-            deck, deckSize,
-            discard, discardSize);
-        if (!ok) {
-            cout << "No saved game found or save file is corrupted.\n";
-            return 0;
+EndgameSolver* createEndgameSolver() {
+    EndgameSolver* s = new EndgameSolver;
+    s->table = new SolverEntry[SOLVER_TABLE_SIZE];
+    memset(s->table, 0, SOLVER_TABLE_SIZE * sizeof(SolverEntry));
+    s->generation = 0;
+    s->nodeBudget = SOLVER_NODE_BUDGET;
+    s->model = 0;
+
+    unsigned long long seed = 0x5EED;
+    for (int p = 0; p < 2; p++) {
+        for (int k = 0; k < CARD_KINDS; k++) s->cardKeys[p][k] = splitMix64(seed);
+    }
+    for (int k = 0; k < CARD_KINDS; k++) s->topKeys[k] = splitMix64(seed);
+    for (int c = 0; c < 5; c++) s->colorKeys[c] = splitMix64(seed);
+    s->moverKey = splitMix64(seed);
+    return s;
+}
+
+void destroyEndgameSolver(EndgameSolver* s) {
+    delete[] s->table;
+    delete s;
+}
+
+// Hands are multisets, so card keys are added rather than xor-ed.
+unsigned long long positionKey(const EndgameSolver& s, const SolverPosition& pos) {
+    unsigned long long key = s.topKeys[cardKind(pos.topCard)] ^ s.colorKeys[pos.activeColor];
+    if (pos.toMove) key ^= s.moverKey;
+    key += (unsigned long long)pos.deckPos * 0x9E3779B97F4A7C15ULL;
+    for (int p = 0; p < 2; p++) {
+        for (int i = 0; i < pos.count[p]; i++) key += s.cardKeys[p][cardKind(pos.hand[p][i])];
+    }
+    return key;
+}
+
+bool sameCard(const Card& a, const Card& b) {
+    return a.color == b.color && a.value == b.value;
+}
+
+// Plays card for the player to move and reports whether they move again
+// (Skip, Reverse, +2 and Wild+4 all skip the opponent with two players).
+// Returns false when a forced draw runs past the known pile.
+bool applySolverPlay(const EndgameSolver& s, SolverPosition& pos, const Card& card, Color color, bool& moveAgain) {
+    CardEffect eff = getCardEffect(card);
+    pos.topCard = card;
+    pos.activeColor = card.color == WILD ? color : card.color;
+
+    moveAgain = eff.skipNext || eff.reverseDir;
+    if (eff.drawCount > 0) {
+        int victim = 1 - pos.toMove;
+        if (pos.deckPos + eff.drawCount > s.deckSize) return false;
+        if (pos.count[victim] + eff.drawCount > SOLVER_MAX_HAND) return false;
+        for (int i = 0; i < eff.drawCount; i++) {
+            pos.hand[victim][pos.count[victim]++] = s.deck[pos.deckPos++];
         }
-        cout << "Game loaded from save.txt\n";
+    }
+    return true;
+}
+
+int solverSearch(EndgameSolver& s, const SolverPosition& pos, int alpha, int beta);
+
+// Value of an unresolved line for the player to move in pos: 0, or the win
+// model's estimate scaled to (-SOLVER_WIN, SOLVER_WIN).
+int solverEstimate(const EndgameSolver& s, const SolverPosition& pos) {
+    if (!s.model) return 0;
+    float x[2 * MODEL_FEATURES];
+    int pile = s.pileSize - pos.deckPos;
+    for (int p = 0; p < 2; p++) {
+        int side = (pos.toMove + p) % 2;
+        modelFeatures(pos.hand[side], pos.count[side], pos.activeColor, p, 2, pile > 0 ? pile : 0, s.totalCards,
+            x + p * MODEL_FEATURES);
+    }
+    double probabilities[2];
+    modelProbabilities(*s.model, x, 2, probabilities);
+    return (int)lround((2 * probabilities[0] - 1) * (SOLVER_WIN - 1));
+}
+
+// Reads the win model for the solver, which only scores two-player
+// positions; says why on cout when it cannot be used.
+bool readSolverModel(const char* path, WinModel& m) {
+    if (!readWinModel(path, m)) {
+        cout << "Cannot read win model " << path << "\n";
+        return false;
+    }
+    if (m.playersCount != 2) {
+        cout << "Win model " << path << " was fitted on " << m.playersCount
+             << " players; the endgame solver needs a 2-player model\n";
+        return false;
+    }
+    return true;
+}
+
+// Value of a child position the search cannot resolve, for the player who
+// moved into it.
+int unresolvedValue(const EndgameSolver& s, SolverPosition& child, int me, bool moveAgain) {
+    if (moveAgain) return solverEstimate(s, child);
+    child.toMove = 1 - me;
+    return -solverEstimate(s, child);
+}
+
+// Value of making move m from pos, from the mover's point of view.
+int solverMoveValue(EndgameSolver& s, const SolverPosition& pos, const SolverMove& m, int alpha, int beta) {
+    SolverPosition child = pos;
+    int me = pos.toMove;
+    bool moveAgain = false;
+
+    if (m.index >= 0) {
+        Card card = child.hand[me][m.index];
+        child.hand[me][m.index] = child.hand[me][--child.count[me]];
+        if (child.count[me] == 0) return SOLVER_WIN;
+        if (!applySolverPlay(s, child, card, m.color, moveAgain)) return unresolvedValue(s, child, me, moveAgain);
     }
     else {
-        playersCount = readPlayersCount();
+        // A draw past the known pile passes the turn; the unknown card is left out.
+        if (child.deckPos >= s.deckSize) return unresolvedValue(s, child, me, false);
+        Card drawn = s.deck[child.deckPos++];
+        if (m.playDrawn) {
+            if (!applySolverPlay(s, child, drawn, m.color, moveAgain)) return unresolvedValue(s, child, me, moveAgain);
+        }
+        else {
+            if (child.count[me] >= SOLVER_MAX_HAND) return unresolvedValue(s, child, me, false);
+            child.hand[me][child.count[me]++] = drawn;
+        }
+    }
+
+    if (moveAgain) return solverSearch(s, child, alpha, beta);
+    child.toMove = 1 - me;
+    return -solverSearch(s, child, -beta, -alpha);
+}
 
-        initPlayers(players, playersCount);
-        buildUnoDeck(deck, deckSize);
-        shuffleDeck(deck, deckSize);
+// Legal moves for the player to move, identical cards only once. Cards that
+// win immediately or skip the opponent come first.
+int generateSolverMoves(const EndgameSolver& s, const SolverPosition& pos, SolverMove moves[]) {
+    int me = pos.toMove;
+    int count = 0;
 
-        discardSize = 0;
+    for (int i = 0; i < pos.count[me]; i++) {
+        const Card& c = pos.hand[me][i];
+        if (!isValidMove(c, pos.topCard, pos.activeColor)) continue;
 
-        dealInitialCards(players, playersCount, deck, deckSize, discard, discardSize);
-        startTopCard(deck, deckSize, discard, discardSize, topCard, activeColor);
+        bool seen = false;
+        for (int j = 0; j < i && !seen; j++) seen = sameCard(pos.hand[me][j], c);
+        if (seen) continue;
 
-        currentPlayer = 0;
-        direction = 1;
+        int colors = c.color == WILD && pos.count[me] > 1 ? 4 : 1;
+        for (int col = 0; col < colors; col++) {
+            SolverMove m;
+            m.index = i;
+            m.playDrawn = false;
+            m.color = (Color)col;
+            moves[count++] = m;
+        }
     }
 
-    runGameLoop(players, playersCount,
-        deck, deckSize,
-        discard, discardSize,
-        topCard, activeColor,
-        currentPlayer, direction);
+    if (count == 0) {
+        // No valid move: draw one, then play it if possible or keep it.
+        SolverMove keep;
+        keep.index = -1;
+        keep.playDrawn = false;
+        keep.color = RED;
+        moves[count++] = keep;
 
-    cout << "Exiting...\n";
-    return 0;
+        if (pos.deckPos < s.deckSize && isValidMove(s.deck[pos.deckPos], pos.topCard, pos.activeColor)) {
+            int colors = s.deck[pos.deckPos].color == WILD ? 4 : 1;
+            for (int col = 0; col < colors; col++) {
+                SolverMove play = keep;
+                play.playDrawn = true;
+                play.color = (Color)col;
+                moves[count++] = play;
+            }
+        }
+        return count;
+    }
+
+    // Move ordering: the last card first, then actions (which keep the turn).
+    int front = 0;
+    for (int i = 0; i < count; i++) {
+        const Card& c = pos.hand[me][moves[i].index];
+        if (pos.count[me] == 1 || c.value >= SKIP) {
+            SolverMove tmp = moves[front];
+            moves[front] = moves[i];
+            moves[i] = tmp;
+            front++;
+        }
+    }
+    return count;
 }
 
+int solverSearch(EndgameSolver& s, const SolverPosition& pos, int alpha, int beta) {
+    if (++s.nodes > s.nodeBudget) {
+        s.aborted = true;
+        return 0;
+    }
+
+    unsigned long long key = positionKey(s, pos);
+    SolverEntry& e = s.table[key & (SOLVER_TABLE_SIZE - 1)];
+    if (e.generation == s.generation && e.key == key) {
+        if (e.bound == BOUND_EXACT) return e.value;
+        if (e.bound == BOUND_LOWER && e.value >= beta) return e.value;
+        if (e.bound == BOUND_UPPER && e.value <= alpha) return e.value;
+    }
+
+    SolverMove moves[SOLVER_MAX_HAND * 4 + 5];
+    int count = generateSolverMoves(s, pos, moves);
+
+    int alphaStart = alpha;
+    int best = -SOLVER_WIN - 1;
+    for (int i = 0; i < count; i++) {
+        int v = solverMoveValue(s, pos, moves[i], alpha, beta);
+        if (s.aborted) return 0;
+        if (v > best) best = v;
+        if (v > alpha) alpha = v;
+        if (alpha >= beta) break;
+    }
+
+    e.key = key;
+    e.value = (signed char)best;
+    e.generation = s.generation;
+    if (best <= alphaStart) e.bound = BOUND_UPPER;
+    else if (best >= beta) e.bound = BOUND_LOWER;
+    else e.bound = BOUND_EXACT;
+    return best;
+}
+
+// Small enough and fully known: two players, standard rules, no stacked draw,
+// one hand nearly empty and neither hand too big for the search.
+bool isSolvableEndgame(const GameState& g) {
+    if (g.playersCount != 2 || g.rules != RULES_STANDARD || g.pendingDraw != 0) return false;
+    int a = g.players[0].cardCount, b = g.players[1].cardCount;
+    if (a > SOLVER_MAX_HAND || b > SOLVER_MAX_HAND) return false;
+    return a <= SOLVER_SHORT_HAND || b <= SOLVER_SHORT_HAND;
+}
+
+// Solves the position for the current player. Returns false when the
+// position is not a solvable endgame or the node budget ran out; result.best
+// is then meaningless.
+bool solveEndgame(GameState& g, EndgameSolver& s, EndgameResult& result) {
+    if (!isSolvableEndgame(g)) return false;
+
+    SolverPosition pos;
+    for (int p = 0; p < 2; p++) {
+        int seat = (g.currentPlayer + p) % 2;
+        pos.count[p] = g.players[seat].cardCount;
+        for (int i = 0; i < pos.count[p]; i++) pos.hand[p][i] = g.players[seat].hand[i];
+    }
+    pos.topCard = g.topCard;
+    pos.activeColor = g.activeColor;
+    pos.toMove = 0;
+    pos.deckPos = 0;
+
+    s.deckSize = g.deckSize < SOLVER_MAX_DRAWS ? g.deckSize : SOLVER_MAX_DRAWS;
+    s.pileSize = g.deckSize;
+    s.totalCards = g.totalCards;
+    for (int i = 0; i < s.deckSize; i++) s.deck[i] = pileSlot(g, i);
+
+    // A new generation invalidates the table without clearing it.
+    if (++s.generation == 0) {
+        memset(s.table, 0, SOLVER_TABLE_SIZE * sizeof(SolverEntry));
+        s.generation = 1;
+    }
+    s.nodes = 0;
+    s.aborted = false;
+
+    SolverMove moves[SOLVER_MAX_HAND * 4 + 5];
+    int count = generateSolverMoves(s, pos, moves);
+
+    result.score = -SOLVER_WIN - 1;
+    result.best = moves[0];
+    int alpha = -SOLVER_WIN;
+    for (int i = 0; i < count; i++) {
+        int v = solverMoveValue(s, pos, moves[i], alpha, SOLVER_WIN);
+        if (s.aborted) break;
+        if (v > result.score) {
+            result.score = v;
+            result.best = moves[i];
+        }
+        if (v > alpha) alpha = v;
+        if (alpha >= SOLVER_WIN) break;
+    }
+    result.nodes = s.nodes;
+    return !s.aborted;
+}
+
+void printSolverMove(ostream& out, GameState& g, const SolverMove& m) {
+    const Player& p = g.players[g.currentPlayer];
+    if (m.index < 0) {
+        out << "draw";
+        if (m.playDrawn) {
+            out << " and play ";
+            printCard(out, pileSlot(g, 0));
+        }
+        else out << " and keep the card";
+    }
+    else {
+        out << "play ";
+        printCard(out, p.hand[m.index]);
+    }
+    bool wild;
+    if (m.index >= 0) wild = p.hand[m.index].color == WILD;
+    else wild = m.playDrawn && pileSlot(g, 0).color == WILD;
+    if (wild) out << " choosing " << colorToChar(m.color);
+}
+
+// ---------- Opening book ----------
+// Early plays repeat across games, so bots can answer them from a table built
+// offline by --build-book. The position of the player to move is abstracted
+// to a key (table size, top card, hand shape); the table maps each key to the
+// class of move that won most often, and AGENT_BOOK plays its best card of
+// that class. Positions without an entry, and everything after the first
+// rounds, go to the bot's heuristic, as do games on another rule set or deck
+// count than the book was built for: the deck count changes how often every
+// card comes up, so the key would mean something else. The file is a header
+// followed by the raw table; it is mapped read-only and shared by every game
+// and thread.
+const int BOOK_VERSION = 2;
+const int BOOK_ROUNDS = 2;              // each seat's first plays come from the book
+const unsigned char BOOK_NO_MOVE = 255;
+
+// Move classes. A switch plays another color on a matching value.
+enum BookMove { BOOK_NUMBER, BOOK_ACTION, BOOK_SWITCH, BOOK_WILD, BOOK_PLUS4, BOOK_MOVES };
+
+// Key fields and their number of values.
+const int BOOK_TABLE_SIZES = 3;   // 2, 3-4, 5 or more players
+const int BOOK_TOP_KINDS = 4;     // number, Skip/Reverse, +2, wild
+const int BOOK_COUNT_LEVELS = 5;  // 0-3 cards of a color, 4 or more
+const int BOOK_ACTION_LEVELS = 3; // 0, 1, 2 or more
+const int BOOK_KEYS = BOOK_TABLE_SIZES * BOOK_TOP_KINDS * BOOK_COUNT_LEVELS * BOOK_COUNT_LEVELS *
+    BOOK_ACTION_LEVELS * 2 * 2;
+
+struct BookHeader {
+    char magic[8];    // "UNOBOOK" and a zero
+    int version;
+    int rules;        // the rule set the book was built for
+    int decks;        // and the deck count
+    int rounds;       // plays per seat it covers
+    int keys;         // BOOK_KEYS
+};
+
+struct OpeningBook {
+    const BookHeader* header;
+    const unsigned char* moves; // a BookMove per key, or BOOK_NO_MOVE
+    void* view;
+    size_t size;
+};
+
+const char BOOK_MAGIC[8] = { 'U', 'N', 'O', 'B', 'O', 'O', 'K', 0 };
+
+int bookMoveOf(const Card& c, Color activeColor) {
+    if (c.color == WILD) return c.value == WILD_PLUS4 ? BOOK_PLUS4 : BOOK_WILD;
+    if (c.color != activeColor) return BOOK_SWITCH;
+    return c.value <= NINE ? BOOK_NUMBER : BOOK_ACTION;
+}
+
+int capLevel(int count, int levels) {
+    return count < levels ? count : levels - 1;
+}
+
+// Key of the position of the player to move.
+int bookKey(const GameState& g) {
+    const Player& p = g.players[g.currentPlayer];
+    int colorCounts[5] = { 0, 0, 0, 0, 0 };
+    int actions = 0, wilds = 0, plus4s = 0;
+    for (int i = 0; i < p.cardCount; i++) {
+        const Card& c = p.hand[i];
+        colorCounts[c.color]++;
+        if (c.color == g.activeColor && c.value > NINE) actions++;
+        if (c.value == WILD_CARD) wilds = 1;
+        if (c.value == WILD_PLUS4) plus4s = 1;
+    }
+    int others = 0;
+    for (int c = 0; c < 4; c++) {
+        if (c != g.activeColor && colorCounts[c] > others) others = colorCounts[c];
+    }
+
+    int tableSize = g.playersCount == 2 ? 0 : g.playersCount <= 4 ? 1 : 2;
+    int top = g.topCard.color == WILD ? 3 : g.topCard.value == PLUS2 ? 2 : g.topCard.value > NINE ? 1 : 0;
+
+    int key = tableSize;
+    key = key * BOOK_TOP_KINDS + top;
+    key = key * BOOK_COUNT_LEVELS + capLevel(colorCounts[g.activeColor], BOOK_COUNT_LEVELS);
+    key = key * BOOK_COUNT_LEVELS + capLevel(others, BOOK_COUNT_LEVELS);
+    key = key * BOOK_ACTION_LEVELS + capLevel(actions, BOOK_ACTION_LEVELS);
+    key = key * 2 + wilds;
+    key = key * 2 + plus4s;
+    return key;
+}
+
+// The highest playable card of the class, or -1 when there is none.
+int bookMoveCard(const GameState& g, int move) {
+    const Player& p = g.players[g.currentPlayer];
+    int best = -1;
+    for (int i = 0; i < p.cardCount; i++) {
+        const Card& c = p.hand[i];
+        if (!isValidMove(c, g.topCard, g.activeColor) || bookMoveOf(c, g.activeColor) != move) continue;
+        if (best < 0 || c.value > p.hand[best].value) best = i;
+    }
+    return best;
+}
+
+// Classes with a playable card, in BookMove order. Returns their number.
+int availableBookMoves(const GameState& g, int moves[]) {
+    const Player& p = g.players[g.currentPlayer];
+    bool seen[BOOK_MOVES] = {};
+    for (int i = 0; i < p.cardCount; i++) {
+        if (isValidMove(p.hand[i], g.topCard, g.activeColor)) seen[bookMoveOf(p.hand[i], g.activeColor)] = true;
+    }
+    int count = 0;
+    for (int m = 0; m < BOOK_MOVES; m++) {
+        if (seen[m]) moves[count++] = m;
+    }
+    return count;
+}
+
+bool inBookRounds(const GameState& g, int rounds) {
+    return g.turns <= rounds * g.playersCount;
+}
+
+// The book's card for the position, or -1 to leave it to the heuristic.
+int bookCardChoice(const GameState& g, const OpeningBook& book) {
+    if (g.rules != book.header->rules || g.deckCount != book.header->decks ||
+        !inBookRounds(g, book.header->rounds)) return -1;
+    int move = book.moves[bookKey(g)];
+    if (move == BOOK_NO_MOVE) return -1;
+    return bookMoveCard(g, move);
+}
+
+void closeOpeningBook(OpeningBook* book) {
+#ifdef _WIN32
+    UnmapViewOfFile(book->view);
+#else
+    munmap(book->view, book->size);
+#endif
+    delete book;
+}
+
+// Maps path read-only. Returns 0 if it cannot be read or is not a book.
+OpeningBook* openOpeningBook(const char* path) {
+    void* view = 0;
+    size_t size = 0;
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if (file == INVALID_HANDLE_VALUE) return 0;
+    LARGE_INTEGER fileSize;
+    if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart >= (LONGLONG)sizeof(BookHeader)) {
+        HANDLE mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+        if (mapping) {
+            view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            size = (size_t)fileSize.QuadPart;
+            CloseHandle(mapping); // the view keeps the mapping alive
+        }
+    }
+    CloseHandle(file);
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(BookHeader)) {
+        size = (size_t)st.st_size;
+        view = mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (view == MAP_FAILED) view = 0;
+    }
+    close(fd); // the mapping outlives the descriptor
+#endif
+    if (!view) return 0;
+
+    OpeningBook* book = new OpeningBook();
+    book->view = view;
+    book->size = size;
+    book->header = (const BookHeader*)view;
+    book->moves = (const unsigned char*)view + sizeof(BookHeader);
+
+    const BookHeader& h = *book->header;
+    bool ok = memcmp(h.magic, BOOK_MAGIC, sizeof(BOOK_MAGIC)) == 0 && h.version == BOOK_VERSION &&
+        h.keys == BOOK_KEYS && h.rules >= 0 && h.rules < RULE_COMBINATIONS && h.decks >= 1 && h.decks <= MAX_DECKS &&
+        h.rounds >= 0 &&
+        size == sizeof(BookHeader) + (size_t)BOOK_KEYS;
+    for (int k = 0; ok && k < BOOK_KEYS; k++) {
+        ok = book->moves[k] < BOOK_MOVES || book->moves[k] == BOOK_NO_MOVE;
+    }
+    if (!ok) {
+        closeOpeningBook(book);
+        return 0;
+    }
+    return book;
+}
+
+// ---------- Agents ----------
+// Every decision in the turn loop goes through one of these. Humans are
+// asked on the console, bots answer from the visible state.
+int readSwapTarget(const GameState& g) {
+    while (true) {
+        cout << "Choose player to swap hands with (1-" << g.playersCount << "): ";
+        int target;
+        cin >> target;
+        target--;
+        if (target >= 0 && target < g.playersCount && target != g.currentPlayer) return target;
+        cout << "Invalid player. Try again.\n";
+    }
+}
+
+bool isHuman(const GameState& g, int player) {
+    return g.players[player].agent == AGENT_HUMAN;
+}
+
+// Maps a position typed by a human to a slot in their hand. Anything out of
+// range is returned unchanged, so the caller can still reject it.
+int handSlot(const GameState& g, int position) {
+    const Player& p = g.players[g.currentPlayer];
+    if (!p.order || position < 0 || position >= p.cardCount) return position;
+    return p.order[position];
+}
+
+// Bot: the color it holds most of, with action cards weighted extra.
+Color botColorChoice(const Player& p) {
+    const double* w = p.weights->w;
+    double scores[4] = { 0, 0, 0, 0 };
+    for (int i = 0; i < p.cardCount; i++) {
+        const Card& c = p.hand[i];
+        if (c.color == WILD) continue;
+        scores[c.color] += 1;
+        if (c.value >= SKIP) scores[c.color] += w[W_COLOR_ACTIONS];
+    }
+    int best = 0;
+    for (int c = 1; c < 4; c++) {
+        if (scores[c] > scores[best]) best = c;
+    }
+    return (Color)best;
+}
+
+// Bot: collects the playable cards in the scratch space and plays the one
+// with the best weighted score; ties go to the first card in hand.
+int botCardChoice(GameState& g) {
+    const Player& p = g.players[g.currentPlayer];
+    const double* w = p.weights->w;
+    int* candidates = g.agentScratch;
+    int count = 0;
+    int colorCounts[5] = { 0, 0, 0, 0, 0 };
+    for (int i = 0; i < p.cardCount; i++) {
+        colorCounts[p.hand[i].color]++;
+        if (isValidMove(p.hand[i], g.topCard, g.activeColor)) candidates[count++] = i;
+    }
+
+    int next = g.currentPlayer;
+    nextPlayerIndex(next, g.direction, g.playersCount);
+    bool threat = g.players[next].cardCount <= 2;
+
+    int best = -1;
+    double bestScore = 0;
+    for (int k = 0; k < count; k++) {
+        const Card& c = p.hand[candidates[k]];
+        bool wild = c.color == WILD;
+        bool action = c.value >= SKIP;
+
+        double score = w[W_FACE_VALUE] * c.value;
+        if (wild) score += w[W_WILD];
+        else {
+            if (action) score += w[W_ACTION];
+            score += w[W_COLOR_KEPT] * (colorCounts[c.color] - 1);
+        }
+        if (threat && action && c.value != WILD_CARD) score += w[W_THREAT];
+
+        if (best < 0 || score > bestScore) {
+            best = candidates[k];
+            bestScore = score;
+        }
+    }
+    return best;
+}
+
+// Fuzz input steers the random agent while it lasts, then the game's
+// generator takes over.
+int randomDecision(GameState& g, int n) {
+    if (g.decisionBytesLeft > 0) {
+        g.decisionBytesLeft--;
+        return *g.decisionBytes++ % n;
+    }
+    return randomBelow(g.rng, n);
+}
+
+bool isRandom(const GameState& g, int player) {
+    return g.players[player].agent == AGENT_RANDOM;
+}
+
+bool isRemote(const GameState& g, int player) {
+    return g.players[player].agent == AGENT_REMOTE;
+}
+
+// Random agent: a random playable card, and now and then any slot (or one
+// past the end) to exercise the rejection of illegal moves.
+int randomCardChoice(GameState& g) {
+    const Player& p = g.players[g.currentPlayer];
+    if (randomDecision(g, 16) == 0) return randomDecision(g, p.cardCount + 1);
+
+    int* candidates = g.agentScratch;
+    int count = 0;
+    for (int i = 0; i < p.cardCount; i++) {
+        if (isValidMove(p.hand[i], g.topCard, g.activeColor)) candidates[count++] = i;
+    }
+    return count > 0 ? candidates[randomDecision(g, count)] : p.cardCount;
+}
+
+// Index of the card to play, or -1 to save and exit (humans only).
+int chooseCardToPlay(GameState& g) {
+    AgentKind agent = g.players[g.currentPlayer].agent;
+    if (agent == AGENT_RANDOM) return randomCardChoice(g);
+    if (agent == AGENT_REMOTE) return g.remoteMove.choice;
+    if (agent == AGENT_BOOK && g.book) {
+        int booked = bookCardChoice(g, *g.book);
+        if (booked >= 0) return booked;
+    }
+    if (agent == AGENT_ENDGAME && g.solver) {
+        EndgameResult r;
+        if (solveEndgame(g, *g.solver, r) && r.best.index >= 0) {
+            g.plannedColor = r.best.color;
+            return r.best.index;
+        }
+    }
+    if (agent != AGENT_HUMAN) return botCardChoice(g);
+
+    cout << "Choose card index to play (or -1 to Save & Exit): ";
+    int choice;
+    cin >> choice;
+    return handSlot(g, choice);
+}
+
+Color chooseColor(GameState& g) {
+    if (isHuman(g, g.currentPlayer)) return askForColorChoice();
+    if (isRemote(g, g.currentPlayer)) return (Color)g.remoteMove.color;
+    if (g.plannedColor >= 0) {
+        Color planned = (Color)g.plannedColor;
+        g.plannedColor = -1;
+        return planned;
+    }
+    if (isRandom(g, g.currentPlayer)) return (Color)randomDecision(g, 4);
+    return botColorChoice(g.players[g.currentPlayer]);
+}
+
+bool choosePlayDrawn(GameState& g) {
+    if (isHuman(g, g.currentPlayer)) return askYesNo("You can play the drawn card. Play it now?");
+    if (isRandom(g, g.currentPlayer)) return randomDecision(g, 2) == 0;
+    if (isRemote(g, g.currentPlayer)) return g.remoteMove.choice != 0;
+
+    if (g.players[g.currentPlayer].agent == AGENT_ENDGAME && g.solver) {
+        // Solve the position from before the draw: the drawn card is the
+        // last one in hand and its pile slot has not been reused yet.
+        Player& p = g.players[g.currentPlayer];
+        p.cardCount--;
+        g.pileStart = (g.pileStart + g.totalCards - 1) % g.totalCards;
+        g.deckSize++;
+
+        EndgameResult r;
+        bool solved = solveEndgame(g, *g.solver, r);
+
+        g.deckSize--;
+        g.pileStart = (g.pileStart + 1) % g.totalCards;
+        p.cardCount++;
+
+        if (solved && r.best.index < 0) {
+            if (r.best.playDrawn) g.plannedColor = r.best.color;
+            return r.best.playDrawn;
+        }
+    }
+    return true;
+}
+
+bool declareUno(GameState& g) {
+    if (isHuman(g, g.currentPlayer)) return checkUnoDeclaration();
+    if (isRandom(g, g.currentPlayer)) return randomDecision(g, 4) != 0;
+    if (isRemote(g, g.currentPlayer)) return g.remoteMove.uno;
+    return true;
+}
+
+int chooseSwapTarget(GameState& g) {
+    if (isHuman(g, g.currentPlayer)) return readSwapTarget(g);
+    if (isRemote(g, g.currentPlayer)) return g.remoteMove.swapTarget;
+    if (isRandom(g, g.currentPlayer)) {
+        int target = randomDecision(g, g.playersCount - 1);
+        return target < g.currentPlayer ? target : target + 1;
+    }
+
+    // Bot: take the smallest hand.
+    int best = -1;
+    for (int i = 0; i < g.playersCount; i++) {
+        if (i == g.currentPlayer) continue;
+        if (best < 0 || g.players[i].cardCount < g.players[best].cardCount) best = i;
+    }
+    return best;
+}
+
+// Remote seats are only asked on their own turn, so they never jump in
+// and never challenge.
+bool chooseJumpIn(GameState& g, int player, const Card& card) {
+    if (isRandom(g, player)) return randomDecision(g, 2) == 0;
+    if (isRemote(g, player)) return false;
+    if (!isHuman(g, player)) return true;
+
+    cout << "Player " << (player + 1) << ", jump in with ";
+    printCard(cout, card);
+    return askYesNo("?");
+}
+
+bool chooseChallenge(GameState& g, int victim) {
+    if (isRandom(g, victim)) return randomDecision(g, 2) == 0;
+    if (!isHuman(g, victim)) return false;
+
+    cout << "Player " << (victim + 1) << ", ";
+    return askYesNo("challenge the Wild+4?");
+}
+
+// Index of a card to stack on the pending draw, or -2 to take the cards.
+int chooseStackCard(GameState& g) {
+    const Player& p = g.players[g.currentPlayer];
+    if (isRemote(g, g.currentPlayer)) return g.remoteMove.choice;
+    if (isRandom(g, g.currentPlayer)) {
+        int* candidates = g.agentScratch;
+        int count = 0;
+        for (int i = 0; i < p.cardCount; i++) {
+            if (isStackable(p.hand[i], g.topCard)) candidates[count++] = i;
+        }
+        int pick = randomDecision(g, count + 1);
+        return pick < count ? candidates[pick] : -2;
+    }
+    if (!isHuman(g, g.currentPlayer)) {
+        for (int i = 0; i < p.cardCount; i++) {
+            if (isStackable(p.hand[i], g.topCard)) return i;
+        }
+        return -2;
+    }
+
+    while (true) {
+        cout << "Stack a draw card (index) or -2 to take " << g.pendingDraw << " cards: ";
+        int choice;
+        cin >> choice;
+        if (choice == -2) return choice;
+        choice = handSlot(g, choice);
+        if (choice >= 0 && choice < p.cardCount && isStackable(p.hand[choice], g.topCard)) return choice;
+        cout << "Invalid move. Try again.\n";
+    }
+}
+
+// ---------- 7-0 rule ----------
+// Hands are pointers into the game's arena, so swapping is O(1). Seats keep
+// their agents; only the cards and their sorted views move.
+void swapHands(Player& a, Player& b) {
+    Player moved = a;
+    a.hand = b.hand;
+    a.cardCount = b.cardCount;
+    a.order = b.order;
+    a.position = b.position;
+    memcpy(a.groupEnd, b.groupEnd, sizeof(a.groupEnd));
+    b.hand = moved.hand;
+    b.cardCount = moved.cardCount;
+    b.order = moved.order;
+    b.position = moved.position;
+    memcpy(b.groupEnd, moved.groupEnd, sizeof(b.groupEnd));
+}
+
+// Every hand moves one seat in the direction of play.
+void rotateHands(Player players[], int playersCount, int direction) {
+    if (direction == 1) {
+        for (int i = playersCount - 1; i > 0; i--) swapHands(players[i], players[i - 1]);
+    }
+    else {
+        for (int i = 0; i < playersCount - 1; i++) swapHands(players[i], players[i + 1]);
+    }
+}
+
+void recordTurn(GameState& g);
+void assertGameInvariants(const GameState& g, bool scanCards);
+
+// ---------- Game loop ----------
+// Draws the penalty for the next player and skips them.
+void punishNextPlayer(GameState& g, int drawCount) {
+    ostream& out = *g.out;
+    nextPlayerIndex(g.currentPlayer, g.direction, g.playersCount);
+    out << "Player " << (g.currentPlayer + 1) << " draws " << drawCount << " cards.\n";
+    applyDrawToPlayer(g, g.players[g.currentPlayer], drawCount);
+    out << "Player " << (g.currentPlayer + 1) << " is skipped.\n";
+    nextPlayerIndex(g.currentPlayer, g.direction, g.playersCount);
+}
+
+// The next player may challenge a Wild+4. If the player who played it still
+// holds a card of the previous active color, they draw 4 instead; otherwise
+// the challenger draws 6. Returns true when the challenge succeeded.
+bool resolvePlus4Challenge(GameState& g, Color colorBefore, int& drawCount) {
+    ostream& out = *g.out;
+    int offender = g.currentPlayer;
+    int victim = offender;
+    nextPlayerIndex(victim, g.direction, g.playersCount);
+
+    if (!chooseChallenge(g, victim)) return false;
+
+    Player& off = g.players[offender];
+    if (hasColor(off, colorBefore)) {
+        out << "Challenge succeeded! Player " << (offender + 1) << " draws 4 cards.\n";
+        applyDrawToPlayer(g, off, 4);
+        return true;
+    }
+
+    out << "Challenge failed!\n";
+    drawCount += 2;
+    return false;
+}
+
+// Plays the card at index for the current player and resolves its effect.
+// Returns true when the game is over.
+template <int RULES>
+bool resolvePlayedCard(GameState& g, int index) {
+    ostream& out = *g.out;
+    Player& p = g.players[g.currentPlayer];
+    Color colorBefore = g.activeColor;
+
+    CardEffect eff = getCardEffect<RULES>(p.hand[index]);
+
+    out << "> Player " << (g.currentPlayer + 1) << " used ";
+    printCard(out, p.hand[index]);
+    out << "\n";
+
+    playCardFromHand(g, p, index);
+
+    if (eff.chooseColor) {
+        g.activeColor = chooseColor(g);
+    }
+    logMove(g, g.topCard);
+    if (g.topCard.value >= SKIP) g.actionCardsPlayed++;
+
+    // UNO
+    enforceUnoRuleIfNeeded(g);
+
+    // Win
+    if (p.cardCount == 0) {
+        out << "Player " << (g.currentPlayer + 1) << " wins!\n";
+        g.winner = g.currentPlayer;
+        return true;
+    }
+
+    if (RULES & RULE_SEVEN_ZERO) {
+        if (eff.swapHands) {
+            int target = chooseSwapTarget(g);
+            swapHands(g.players[g.currentPlayer], g.players[target]);
+            out << "Player " << (g.currentPlayer + 1) << " swapped hands with player " << (target + 1) << ".\n";
+        }
+        if (eff.rotateHands) {
+            rotateHands(g.players, g.playersCount, g.direction);
+            out << "All hands passed to the next player.\n";
+        }
+    }
+
+    // Reverse with 2 players = Skip
+    if (eff.reverseDir && g.playersCount == 2) {
+        eff.reverseDir = false;
+        eff.skipNext = true;
+    }
+
+    if (eff.reverseDir) g.direction *= -1;
+
+    if ((RULES & RULE_CHALLENGE_PLUS4) && eff.drawCount == 4) {
+        int drawCount = g.pendingDraw + eff.drawCount;
+        if (resolvePlus4Challenge(g, colorBefore, drawCount)) {
+            // The Wild+4 is cancelled; an earlier stack still waits for the victim.
+            nextPlayerIndex(g.currentPlayer, g.direction, g.playersCount);
+            return false;
+        }
+        if (drawCount > g.pendingDraw + eff.drawCount) {
+            g.pendingDraw = 0;
+            punishNextPlayer(g, drawCount);
+            return false;
+        }
+    }
+
+    // Stacking: the draw is passed on instead of being taken immediately.
+    if ((RULES & RULE_STACKING) && eff.drawCount > 0) {
+        g.pendingDraw += eff.drawCount;
+        nextPlayerIndex(g.currentPlayer, g.direction, g.playersCount);
+        return false;
+    }
+
+    // Apply effects to next player immediately
+    if (eff.drawCount > 0) {
+        punishNextPlayer(g, eff.drawCount);
+    }
+    else if (eff.skipNext) {
+        nextPlayerIndex(g.currentPlayer, g.direction, g.playersCount);
+        out << "Player " << (g.currentPlayer + 1) << " is skipped.\n";
+        nextPlayerIndex(g.currentPlayer, g.direction, g.playersCount);
+    }
+    else {
+        nextPlayerIndex(g.currentPlayer, g.direction, g.playersCount);
+    }
+    return false;
+}
+
+// Stacking: the current player either stacks another draw card (choice is
+// its hand slot) or takes the whole pending draw and loses the turn.
+// Returns true when the game is over.
+template <int RULES>
+bool resolvePendingDraw(GameState& g, int choice) {
+    if (choice >= 0) return resolvePlayedCard<RULES>(g, choice);
+
+    Player& p = g.players[g.currentPlayer];
+    *g.out << "Player " << (g.currentPlayer + 1) << " draws " << g.pendingDraw << " cards.\n";
+    applyDrawToPlayer(g, p, g.pendingDraw);
+    g.pendingDraw = 0;
+    nextPlayerIndex(g.currentPlayer, g.direction, g.playersCount);
+    return false;
+}
+
+// No valid move: draws one card, or until a playable one with
+// RULE_DRAW_UNTIL_PLAYABLE. A playable card is offered in the next step,
+// otherwise the turn passes. Returns true when the draw pile is exhausted.
+template <int RULES>
+bool drawForTurn(GameState& g) {
+    ostream& out = *g.out;
+    Player& p = g.players[g.currentPlayer];
+
+    if (RULES & RULE_DRAW_UNTIL_PLAYABLE) out << "No suitable cards. Drawing until a card can be played...\n";
+    else out << "No suitable cards. Automatically drawing 1 card...\n";
+
+    Card drawn;
+    while (true) {
+        if (!drawFromDeck(g, drawn)) {
+            out << "No cards left to draw.\n";
+            return true;
+        }
+
+        out << "Drawn card: ";
+        printCard(out, drawn);
+        out << "\n";
+
+        addToHand(p, drawn);
+
+        if (!(RULES & RULE_DRAW_UNTIL_PLAYABLE)) break;
+        if (isValidMove(drawn, g.topCard, g.activeColor)) break;
+    }
+
+    if (isValidMove(drawn, g.topCard, g.activeColor)) g.turnStage = STAGE_DRAWN;
+    else nextPlayerIndex(g.currentPlayer, g.direction, g.playersCount);
+    return false;
+}
+
+// ---------- Turn pipeline ----------
+// A game advances in steps of one decision each:
+//   observe  work out what the current player has to decide
+//   render   show the table to them (only when g.render is set)
+//   decide   ask their agent
+//   resolve  apply the answer and its effects
+// runGameLoop steps one game to the end. runGameBatch runs every stage over
+// a whole batch of games before the next stage (--simulate --batch).
+// Smaller choices made while an effect resolves (color, swap target,
+// challenge, UNO) are still asked from inside resolve.
+
+template <int RULES>
+TurnPhase observeTurn(GameState& g) {
+    if (g.turnStage == STAGE_DRAWN) return PHASE_PLAY_DRAWN;
+    if (g.turnStage != STAGE_TURN) {
+        if (g.turnLimit && g.turns >= g.turnLimit) return PHASE_OVER;
+
+        if ((RULES & RULE_JUMP_IN) && g.turnStage == STAGE_JUMP_IN && g.pendingDraw == 0) {
+            for (int i = 0; i < g.playersCount; i++) {
+                if (i != g.currentPlayer && findIdenticalCard(g.players[i], g.topCard) >= 0) return PHASE_JUMP_IN;
+            }
+        }
+        g.turnStage = STAGE_TURN;
+
+        g.turns++;
+        if (g.turnLog) recordTurn(g);
+        if (g.checkInvariants) assertGameInvariants(g, g.turns % INVARIANT_SCAN_INTERVAL == 0);
+        if (g.autosave && g.turns % g.autosave->interval == 0) pushAutosave(*g.autosave, g);
+        if (g.spectators) publishSpectatorView(*g.spectators, g);
+    }
+
+    const Player& p = g.players[g.currentPlayer];
+    if (p.cardCount == 0) return PHASE_WON; // should happen right after play, but safe here too
+    if ((RULES & RULE_STACKING) && g.pendingDraw > 0) return PHASE_PENDING_DRAW;
+    if (!hasAnyValidMove(p, g.topCard, g.activeColor)) return PHASE_DRAW;
+    return PHASE_PLAY;
+}
+
+void renderTurn(GameState& g, TurnPhase phase) {
+    if (!g.render || phase < PHASE_WON) return;
+
+    ostream& out = *g.out;
+    const Player& p = g.players[g.currentPlayer];
+    out << "\n--- UNO ---\n";
+    out << "Current card: ";
+    printCard(out, g.topCard);
+    out << "\n";
+
+    out << "Player " << (g.currentPlayer + 1) << " - Your cards:\n";
+    printPlayerHand(out, p, phase == PHASE_PLAY ? &g.topCard : 0, g.activeColor);
+}
+
+// The agent's answer for the phase: the jumping player (-1 = nobody), 1 or 0
+// for playing the drawn card, or a hand slot (-1 = take the pending draw,
+// or save and quit in PHASE_PLAY).
+int decideTurn(GameState& g, TurnPhase phase) {
+    if (phase == PHASE_JUMP_IN) {
+        for (int i = 0; i < g.playersCount; i++) {
+            if (i == g.currentPlayer) continue;
+            int idx = findIdenticalCard(g.players[i], g.topCard);
+            if (idx >= 0 && chooseJumpIn(g, i, g.players[i].hand[idx])) return i;
+        }
+        return -1;
+    }
+    if (phase == PHASE_PLAY_DRAWN) return choosePlayDrawn(g) ? 1 : 0;
+    if (phase == PHASE_PENDING_DRAW) {
+        return hasStackableCard(g.players[g.currentPlayer], g.topCard) ? chooseStackCard(g) : -1;
+    }
+    if (phase == PHASE_PLAY) return chooseCardToPlay(g);
+    return 0;
+}
+
+// Returns true when the game is over.
+template <int RULES>
+bool resolveTurn(GameState& g, TurnPhase phase, int choice) {
+    ostream& out = *g.out;
+
+    if (phase == PHASE_OVER) return true;
+
+    if (phase == PHASE_JUMP_IN) {
+        // Nobody jumped in: the current player's turn goes ahead next step.
+        if (choice < 0) {
+            g.turnStage = STAGE_BEGIN;
+            return false;
+        }
+        g.currentPlayer = choice;
+        g.turns++;
+        if (g.turnLog) recordTurn(g);
+        return resolvePlayedCard<RULES>(g, findIdenticalCard(g.players[choice], g.topCard));
+    }
+
+    Player& p = g.players[g.currentPlayer];
+    g.turnStage = STAGE_JUMP_IN; // whatever happens below ends the turn, unless noted
+
+    if (phase == PHASE_PLAY_DRAWN) {
+        if (choice) return resolvePlayedCard<RULES>(g, p.cardCount - 1);
+        nextPlayerIndex(g.currentPlayer, g.direction, g.playersCount);
+        return false;
+    }
+
+    if (phase == PHASE_WON) {
+        out << "Player " << (g.currentPlayer + 1) << " wins!\n";
+        g.winner = g.currentPlayer;
+        return true;
+    }
+
+    if (phase == PHASE_PENDING_DRAW) return resolvePendingDraw<RULES>(g, choice);
+    if (phase == PHASE_DRAW) return drawForTurn<RULES>(g);
+
+    if (choice == -1) {
+        if (g.autosave) stopAutosave(*g.autosave, false); // an older snapshot must not overwrite this save
+        long long start = metricsClock();
+        bool ok = saveGame("save.txt", g);
+        if (g.metrics) recordLatency(*g.metrics, LATENCY_SAVE, metricsClock() - start);
+        if (ok) cout << "Game saved to save.txt\n";
+        else cout << "Failed to save game.\n";
+        if (ok && g.autosave) remove(AUTOSAVE_FILE);
+        return true;
+    }
+
+    if (choice < 0 || choice >= p.cardCount || !isValidMove(p.hand[choice], g.topCard, g.activeColor)) {
+        out << "Invalid move. Try again.\n";
+        g.turnStage = STAGE_TURN; // same player again, same turn
+        return false;
+    }
+
+    return resolvePlayedCard<RULES>(g, choice);
+}
+
+template <int RULES>
+void runGameLoopT(GameState& g) {
+    while (true) {
+        int turns = g.turns;
+        TurnPhase phase = observeTurn<RULES>(g);
+        renderTurn(g, phase);
+        if (g.metrics) {
+            long long start = metricsClock();
+            int choice = decideTurn(g, phase);
+            long long decided = metricsClock();
+            bool over = resolveTurn<RULES>(g, phase, choice);
+            recordTurnMetrics(*g.metrics, g.turns != turns, start, decided, metricsClock());
+            if (over) return;
+            continue;
+        }
+        int choice = decideTurn(g, phase);
+        if (resolveTurn<RULES>(g, phase, choice)) return;
+    }
+}
+
+// ---------- Engine dispatch ----------
+// One specialized engine per rule set, picked at runtime from the table's rules.
+template <int RULES>
+void fillGameEngines(GameEngine engines[]) {
+    engines[RULES].run = runGameLoopT<RULES>;
+    engines[RULES].observe = observeTurn<RULES>;
+    engines[RULES].resolve = resolveTurn<RULES>;
+    fillGameEngines<RULES + 1>(engines);
+}
+
+template <>
+void fillGameEngines<RULE_COMBINATIONS>(GameEngine[]) {}
+
+struct GameEngineTable {
+    GameEngine engines[RULE_COMBINATIONS];
+};
+
+GameEngineTable makeGameEngineTable() {
+    GameEngineTable table;
+    fillGameEngines<0>(table.engines);
+    return table;
+}
+
+const GameEngine& gameEngine(int rules) {
+    static const GameEngineTable table = makeGameEngineTable(); // built once, thread-safe
+    return table.engines[rules];
+}
+
+void runGameLoop(GameState& g) {
+    if (g.metrics) startMeteredGame(*g.metrics);
+    gameEngine(g.rules).run(g);
+    if (g.metrics) finishMeteredGame(*g.metrics, g.winner >= 0);
+    if (g.spectators) publishSpectatorView(*g.spectators, g); // the final table
+}
+
+// Plays count games to the end, GAME_BATCH_SIZE at a time. Each stage runs
+// over the whole batch before the next one starts, so the batch moves one
+// step per round and finished games drop out; the games may use different
+// rule sets. games[] itself is left in order.
+const int GAME_BATCH_SIZE = 1024;
+
+void runGameBatch(GameState* games[], int count) {
+    GameState* batch[GAME_BATCH_SIZE];
+    TurnPhase phases[GAME_BATCH_SIZE];
+    int choices[GAME_BATCH_SIZE];
+
+    for (int first = 0; first < count; first += GAME_BATCH_SIZE) {
+        int active = count - first < GAME_BATCH_SIZE ? count - first : GAME_BATCH_SIZE;
+        for (int i = 0; i < active; i++) batch[i] = games[first + i];
+
+        while (active > 0) {
+            for (int i = 0; i < active; i++) phases[i] = gameEngine(batch[i]->rules).observe(*batch[i]);
+            for (int i = 0; i < active; i++) renderTurn(*batch[i], phases[i]);
+            for (int i = 0; i < active; i++) choices[i] = decideTurn(*batch[i], phases[i]);
+
+            int running = 0;
+            for (int i = 0; i < active; i++) {
+                if (!gameEngine(batch[i]->rules).resolve(*batch[i], phases[i], choices[i])) batch[running++] = batch[i];
+            }
+            active = running;
+        }
+    }
+}
+
+// ---------- Statistics export ----------
+// Streaming columnar writer for simulation records. Each thread appends rows
+// to its own ColumnBuffer; a full block is narrowed to fixed-width binary
+// columns (one little-endian file per column) or formatted as CSV, and only
+// the final write happens under the table lock.
+const int EXPORT_MAX_COLUMNS = 8;
+const int EXPORT_BLOCK_ROWS = 16384;
+const int EXPORT_MAX_DIGITS = 21;      // a signed 64-bit value plus separator
+
+struct ColumnSpec {
+    const char* name;
+    int width;        // bytes per value in binary mode
+    bool isSigned;
+};
+
+const ColumnSpec GAME_COLUMNS[] = {
+    { "seed", 8, false },
+    { "players", 1, false },
+    { "winner", 1, true },         // -1 for an unfinished game
+    { "turns", 4, true },
+    { "refills", 4, true },
+    { "cards_drawn", 4, true },
+    { "action_cards", 4, true },
+    { "uno_penalties", 4, true },
+};
+const int GAME_COLUMN_COUNT = sizeof(GAME_COLUMNS) / sizeof(GAME_COLUMNS[0]);
+
+const ColumnSpec TURN_COLUMNS[] = {
+    { "seed", 8, false },
+    { "turn", 4, true },
+    { "player", 1, false },
+    { "hand_size", 2, false },
+    { "top_card", 1, false },      // cardKind(): color * 15 + value
+    { "active_color", 1, false },
+};
+const int TURN_COLUMN_COUNT = sizeof(TURN_COLUMNS) / sizeof(TURN_COLUMNS[0]);
+
+struct ColumnTable {
+    const ColumnSpec* specs;
+    int columns;
+    bool csv;
+    ofstream files[EXPORT_MAX_COLUMNS]; // one per column, or files[0] for CSV
+    mutex lock;
+    long long rows;
+};
+
+struct ColumnBuffer {
+    ColumnTable* table;
+    long long* values[EXPORT_MAX_COLUMNS]; // column-major, EXPORT_BLOCK_ROWS each
+    int rows;
+    char* staging;                         // narrowed or formatted block
+};
+
+// Writes <prefix>_<name>_<column>.bin files plus a schema, or <prefix>_<name>.csv.
+bool openColumnTable(ColumnTable& t, const char* prefix, const char* name,
+    const ColumnSpec specs[], int columns, bool csv) {
+    t.specs = specs;
+    t.columns = columns;
+    t.csv = csv;
+    t.rows = 0;
+
+    char path[512];
+    if (csv) {
+        snprintf(path, sizeof(path), "%s_%s.csv", prefix, name);
+        t.files[0].open(path, ios::binary);
+        if (!t.files[0]) return false;
+        for (int c = 0; c < columns; c++) t.files[0] << (c ? "," : "") << specs[c].name;
+        t.files[0] << "\n";
+        return true;
+    }
+
+    snprintf(path, sizeof(path), "%s_%s_schema.txt", prefix, name);
+    ofstream schema(path);
+    if (!schema) return false;
+    schema << "# column bytes signed (little-endian, one file per column)\n";
+    for (int c = 0; c < columns; c++) {
+        schema << specs[c].name << " " << specs[c].width << " " << (specs[c].isSigned ? 1 : 0) << "\n";
+        snprintf(path, sizeof(path), "%s_%s_%s.bin", prefix, name, specs[c].name);
+        t.files[c].open(path, ios::binary);
+        if (!t.files[c]) return false;
+    }
+    return true;
+}
+
+void closeColumnTable(ColumnTable& t) {
+    for (int c = 0; c < EXPORT_MAX_COLUMNS; c++) {
+        if (t.files[c].is_open()) t.files[c].close();
+    }
+}
+
+void createColumnBuffer(ColumnBuffer& b, ColumnTable& t) {
+    b.table = &t;
+    b.rows = 0;
+    for (int c = 0; c < t.columns; c++) b.values[c] = new long long[EXPORT_BLOCK_ROWS];
+    b.staging = new char[(size_t)EXPORT_BLOCK_ROWS * t.columns * EXPORT_MAX_DIGITS];
+}
+
+void destroyColumnBuffer(ColumnBuffer& b) {
+    for (int c = 0; c < b.table->columns; c++) delete[] b.values[c];
+    delete[] b.staging;
+}
+
+char* formatInteger(char* p, long long v, bool isSigned) {
+    unsigned long long u = (unsigned long long)v;
+    if (isSigned && v < 0) {
+        *p++ = '-';
+        u = 0 - u;
+    }
+    char digits[20];
+    int n = 0;
+    do {
+        digits[n++] = (char)('0' + u % 10);
+        u /= 10;
+    } while (u);
+    while (n) *p++ = digits[--n];
+    return p;
+}
+
+void flushColumnBuffer(ColumnBuffer& b) {
+    if (b.rows == 0) return;
+    ColumnTable& t = *b.table;
+
+    if (t.csv) {
+        char* p = b.staging;
+        for (int r = 0; r < b.rows; r++) {
+            for (int c = 0; c < t.columns; c++) {
+                if (c) *p++ = ',';
+                p = formatInteger(p, b.values[c][r], t.specs[c].isSigned);
+            }
+            *p++ = '\n';
+        }
+        lock_guard<mutex> guard(t.lock);
+        t.files[0].write(b.staging, p - b.staging);
+        t.rows += b.rows;
+    }
+    else {
+        // Narrow every column first so the lock covers only the writes; all
+        // columns of a block go out together, keeping the files row-aligned.
+        char* column[EXPORT_MAX_COLUMNS];
+        char* p = b.staging;
+        for (int c = 0; c < t.columns; c++) {
+            column[c] = p;
+            int width = t.specs[c].width;
+            for (int r = 0; r < b.rows; r++) {
+                unsigned long long v = (unsigned long long)b.values[c][r];
+                for (int k = 0; k < width; k++) *p++ = (char)(v >> (8 * k));
+            }
+        }
+        lock_guard<mutex> guard(t.lock);
+        for (int c = 0; c < t.columns; c++) {
+            t.files[c].write(column[c], (streamsize)b.rows * t.specs[c].width);
+        }
+        t.rows += b.rows;
+    }
+    b.rows = 0;
+}
+
+void appendRow(ColumnBuffer& b, const long long values[]) {
+    for (int c = 0; c < b.table->columns; c++) b.values[c][b.rows] = values[c];
+    if (++b.rows == EXPORT_BLOCK_ROWS) flushColumnBuffer(b);
+}
+
+void recordTurn(GameState& g) {
+    const Player& p = g.players[g.currentPlayer];
+    long long row[TURN_COLUMN_COUNT] = {
+        (long long)g.seed, g.turns, g.currentPlayer, p.cardCount, cardKind(g.topCard), g.activeColor
+    };
+    appendRow(*g.turnLog, row);
+}
+
+void recordGame(ColumnBuffer& b, const GameState& g) {
+    long long row[GAME_COLUMN_COUNT] = {
+        (long long)g.seed, g.playersCount, g.winner, g.turns,
+        g.refills, g.cardsDrawn, g.actionCardsPlayed, g.unoPenalties
+    };
+    appendRow(b, row);
+}
+
+// ---------- Simulation ----------
+// Bot-only games with no console output. Game n of a run uses seed
+// firstSeed + n, so results do not depend on how games are split between
+// threads. Each thread has its own arena pool, solver and export buffers.
+struct SimulationJob {
+    const SimulationConfig* config;
+    int firstGame;
+    int games;
+    SimulationStats stats;
+};
+
+void clearStats(SimulationStats& stats) {
+    stats.games = 0;
+    stats.unfinished = 0;
+    stats.turns = 0;
+    stats.arenasCreated = 0;
+    for (int i = 0; i < MAX_PLAYERS; i++) stats.wins[i] = 0;
+}
+
+void addStats(SimulationStats& total, const SimulationStats& s) {
+    total.games += s.games;
+    total.unfinished += s.unfinished;
+    total.turns += s.turns;
+    total.arenasCreated += s.arenasCreated;
+    for (int i = 0; i < MAX_PLAYERS; i++) total.wins[i] += s.wins[i];
+}
+
+// Deals one silent bot game from seed; weights may be null for the defaults.
+void setupSilentGame(GameState& g, ArenaPool& pool, const SimulationConfig& config,
+    const AgentKind agents[], const BotWeights* const weights[], unsigned long long seed, ostream& silent, EndgameSolver* solver,
+    ColumnBuffer* turnLog) {
+    createGame(g, pool, config.playersCount, config.deckCount, config.rules);
+    seedGame(g, seed);
+    g.out = &silent;
+    setRender(g, false);
+    g.solver = solver;
+    g.book = config.book;
+    g.turnLog = turnLog;
+    for (int i = 0; i < g.playersCount; i++) {
+        g.players[i].agent = agents[i];
+        if (weights) g.players[i].weights = weights[i];
+    }
+
+    newShuffledDeck(g);
+    dealInitialCards(g);
+    startTopCard(g);
+}
+
+// Plays one silent bot game from seed. The finished game is left in g for
+// the caller to read and destroy.
+void playSilentGame(GameState& g, ArenaPool& pool, const SimulationConfig& config,
+    const AgentKind agents[], const BotWeights* const weights[], unsigned long long seed, ostream& silent, EndgameSolver* solver,
+    ColumnBuffer* turnLog) {
+    setupSilentGame(g, pool, config, agents, weights, seed, silent, solver, turnLog);
+    runGameLoop(g);
+}
+
+void playLockstepGames(const SimulationConfig& config, int firstGame, int games, int width, ArenaPool& pool,
+    SimulationStats& stats, ColumnBuffer* gameLog, ColumnBuffer* turnLog);
+
+void simulateGames(SimulationJob* job) {
+    const SimulationConfig& config = *job->config;
+    SimulationStats& stats = job->stats;
+    ArenaPool pool = {};
+    ostream silent(0);
+    EndgameSolver* solver = 0;
+    for (int i = 0; i < config.playersCount; i++) {
+        if (config.agents[i] == AGENT_ENDGAME && !solver) solver = createEndgameSolver();
+    }
+    if (solver) solver->model = config.model;
+
+    ColumnBuffer gameLog, turnLog;
+    if (config.gameTable) createColumnBuffer(gameLog, *config.gameTable);
+    if (config.turnTable) createColumnBuffer(turnLog, *config.turnTable);
+
+    clearStats(stats);
+
+    // Games are played config.batchSize at a time (see runGameBatch and
+    // playLockstepGames); turn rows of a batch interleave.
+    int batchSize = config.batchSize < 1 ? 1 : config.batchSize;
+    if (config.lockstep) {
+        playLockstepGames(config, job->firstGame, job->games, batchSize, pool, stats,
+            config.gameTable ? &gameLog : 0, config.turnTable ? &turnLog : 0);
+    }
+    GameState* games = config.lockstep ? 0 : new GameState[batchSize];
+    GameState* batch[GAME_BATCH_SIZE];
+    for (int first = 0; games && first < job->games; first += batchSize) {
+        int count = job->games - first < batchSize ? job->games - first : batchSize;
+        for (int i = 0; i < count; i++) {
+            GameState& g = games[i];
+            g = GameState();
+            setupSilentGame(g, pool, config, config.agents, 0, config.firstSeed + job->firstGame + first + i, silent, solver,
+                config.turnTable ? &turnLog : 0);
+            batch[i] = &g;
+        }
+
+        runGameBatch(batch, count);
+
+        for (int i = 0; i < count; i++) {
+            GameState& g = games[i];
+            stats.games++;
+            stats.turns += g.turns;
+            if (g.winner >= 0) stats.wins[g.winner]++;
+            else stats.unfinished++;
+            if (config.gameTable) recordGame(gameLog, g);
+
+            destroyGame(g, pool);
+        }
+    }
+    delete[] games;
+
+    if (config.gameTable) {
+        flushColumnBuffer(gameLog);
+        destroyColumnBuffer(gameLog);
+    }
+    if (config.turnTable) {
+        flushColumnBuffer(turnLog);
+        destroyColumnBuffer(turnLog);
+    }
+    stats.arenasCreated = pool.arenasCreated;
+    destroyArenaPool(pool);
+    if (solver) destroyEndgameSolver(solver);
+}
+
+void runSimulation(const SimulationConfig& config, int games, int threads, SimulationStats& stats) {
+    if (threads > games) threads = games;
+    SimulationJob* jobs = new SimulationJob[threads];
+    thread* workers = new thread[threads];
+
+    int first = 0;
+    for (int t = 0; t < threads; t++) {
+        jobs[t].config = &config;
+        jobs[t].firstGame = first;
+        jobs[t].games = games / threads + (t < games % threads ? 1 : 0);
+        first += jobs[t].games;
+        if (t > 0) workers[t] = thread(simulateGames, &jobs[t]);
+    }
+    simulateGames(&jobs[0]);
+
+    clearStats(stats);
+    for (int t = 0; t < threads; t++) {
+        if (t > 0) workers[t].join();
+        addStats(stats, jobs[t].stats);
+    }
+
+    delete[] workers;
+    delete[] jobs;
+}
+
+void printSimulationTotals(const SimulationStats& stats, unsigned long long seed, int playersCount) {
+    cout << "Seed: " << seed << "\n";
+    cout << "Games: " << stats.games << " (" << stats.unfinished << " unfinished)\n";
+    cout << "Average turns: " << (double)stats.turns / stats.games << "\n";
+    for (int i = 0; i < playersCount; i++) {
+        cout << "Player " << (i + 1) << " wins: " << stats.wins[i] << "\n";
+    }
+}
+
+// One letter per seat: b = bot, e = bot with the endgame solver, o = bot
+// with the opening book (--book), r = random.
+bool parseAgents(const char* text, int playersCount, AgentKind agents[]) {
+    if ((int)strlen(text) != playersCount) return false;
+    for (int i = 0; i < playersCount; i++) {
+        if (text[i] == 'b') agents[i] = AGENT_BOT;
+        else if (text[i] == 'e') agents[i] = AGENT_ENDGAME;
+        else if (text[i] == 'o') agents[i] = AGENT_BOOK;
+        else if (text[i] == 'r') agents[i] = AGENT_RANDOM;
+        else return false;
+    }
+    return true;
+}
+
+// ---------- Result cache ----------
+// --simulate --cache DIR keeps the results of earlier runs. Seeds are cut
+// into aligned blocks of CACHE_BLOCK_GAMES; a run whose seed range covers a
+// whole block takes its totals from the cache when they are there, and
+// plays and stores them when not. The partial blocks at either end of a
+// range are always played. One file per configuration, named by a hash of
+// the engine version, table, rules, agents and their parameters (bot
+// weights, book and win model), so anything that can change a seeded game
+// gets a file of its own.
+const int CACHE_BLOCK_GAMES = 1024;
+
+struct CachedBlock {
+    unsigned long long block; // seeds block * CACHE_BLOCK_GAMES on
+    SimulationStats stats;
+};
+
+struct ResultCache {
+    char path[512];
+    unsigned long long key;
+    int playersCount;
+    CachedBlock* blocks;      // sorted by block
+    int count;
+    int capacity;
+};
+
+void hashBytes(unsigned long long& h, const void* data, size_t size) {
+    const unsigned char* p = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++) h = (h ^ p[i]) * 0x100000001B3ULL;
+}
+
+unsigned long long simulationKey(const SimulationConfig& config) {
+    unsigned long long h = 0xCBF29CE484222325ULL;
+    int fields[4] = { ENGINE_VERSION, config.playersCount, config.deckCount, config.rules };
+    hashBytes(h, fields, sizeof(fields));
+    for (int i = 0; i < config.playersCount; i++) {
+        int agent = config.agents[i];
+        hashBytes(h, &agent, sizeof(agent));
+    }
+    hashBytes(h, DEFAULT_BOT_WEIGHTS.w, sizeof(DEFAULT_BOT_WEIGHTS.w));
+    if (config.book) hashBytes(h, config.book->view, config.book->size);
+    if (config.model) hashBytes(h, config.model, sizeof(WinModel));
+    return h;
+}
+
+// Index of the first cached block at or after block.
+int lowerCachedBlock(const ResultCache& c, unsigned long long block) {
+    int lo = 0, hi = c.count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (c.blocks[mid].block < block) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+const CachedBlock* findCachedBlock(const ResultCache& c, unsigned long long block) {
+    int i = lowerCachedBlock(c, block);
+    return i < c.count && c.blocks[i].block == block ? &c.blocks[i] : 0;
+}
+
+void addCachedBlock(ResultCache& c, unsigned long long block, const SimulationStats& stats) {
+    int i = lowerCachedBlock(c, block);
+    if (i < c.count && c.blocks[i].block == block) return;
+    if (c.count == c.capacity) {
+        c.capacity = c.capacity ? c.capacity * 2 : 64;
+        CachedBlock* grown = new CachedBlock[c.capacity];
+        if (c.count) memcpy(grown, c.blocks, c.count * sizeof(CachedBlock));
+        delete[] c.blocks;
+        c.blocks = grown;
+    }
+    memmove(c.blocks + i + 1, c.blocks + i, (c.count - i) * sizeof(CachedBlock));
+    c.blocks[i].block = block;
+    c.blocks[i].stats = stats;
+    c.blocks[i].stats.arenasCreated = 0;
+    c.count++;
+}
+
+// A file that does not match the key or does not parse is ignored, and
+// rewritten with the next new block.
+void readResultCache(ResultCache& c) {
+    ifstream in(c.path);
+    char word[32];
+    unsigned long long key;
+    int playersCount, blockGames;
+    if (!(in >> setw(sizeof(word)) >> word) || strcmp(word, "UNO_CACHE_V1") != 0) return;
+    if (!(in >> hex >> key >> dec >> playersCount >> blockGames)) return;
+    if (key != c.key || playersCount != c.playersCount || blockGames != CACHE_BLOCK_GAMES) return;
+
+    unsigned long long block;
+    while (in >> block) {
+        SimulationStats s;
+        clearStats(s);
+        bool ok = (bool)(in >> s.games >> s.unfinished >> s.turns);
+        int won = 0;
+        for (int i = 0; ok && i < playersCount; i++) {
+            ok = in >> s.wins[i] && s.wins[i] >= 0;
+            won += s.wins[i];
+        }
+        if (!ok || s.games != CACHE_BLOCK_GAMES || s.unfinished < 0 || s.turns < 0 || won + s.unfinished != s.games) break;
+        addCachedBlock(c, block, s);
+    }
+}
+
+void openResultCache(ResultCache& c, const char* dir, const SimulationConfig& config) {
+#ifdef _WIN32
+    CreateDirectoryA(dir, 0);
+#else
+    mkdir(dir, 0777);
+#endif
+    c.key = simulationKey(config);
+    c.playersCount = config.playersCount;
+    c.blocks = 0;
+    c.count = 0;
+    c.capacity = 0;
+    if (snprintf(c.path, sizeof(c.path), "%s/%016llx.sim", dir, c.key) >= (int)sizeof(c.path)) c.path[0] = '\0';
+    else readResultCache(c);
+}
+
+// Several runs may share the directory, so the temporary file is named by
+// the process.
+bool writeResultCache(const ResultCache& c) {
+    char temp[512 + 32];
+    if (snprintf(temp, sizeof(temp), "%s.%d.tmp", c.path, processId()) >= (int)sizeof(temp)) return false;
+    FILE* f = fopen(temp, "w");
+    if (!f) return false;
+
+    StdioBuffer buffer(f);
+    ostream out(&buffer);
+    out << "UNO_CACHE_V1 " << hex << c.key << dec << " " << c.playersCount << " " << CACHE_BLOCK_GAMES << "\n";
+    for (int b = 0; b < c.count; b++) {
+        const SimulationStats& s = c.blocks[b].stats;
+        out << c.blocks[b].block << " " << s.games << " " << s.unfinished << " " << s.turns;
+        for (int i = 0; i < c.playersCount; i++) out << " " << s.wins[i];
+        out << "\n";
+    }
+    bool ok = out.good() && fflush(f) == 0 && syncFile(f);
+    if (fclose(f) != 0) ok = false;
+    if (ok) ok = replaceFile(temp, c.path);
+    if (!ok) remove(temp);
+    return ok;
+}
+
+void destroyResultCache(ResultCache& c) {
+    delete[] c.blocks;
+    c.blocks = 0;
+}
+
+void simulateJobs(SimulationJob* jobs, int count, atomic<int>* next) {
+    for (int j = next->fetch_add(1); j < count; j = next->fetch_add(1)) simulateGames(&jobs[j]);
+}
+
+// Like runSimulation, but whole blocks found in the cache are not played.
+// Every missing block and partial end is a job of its own; threads take
+// jobs in turn. Game n still uses seed config.firstSeed + n, so the totals
+// match an uncached run exactly.
+void runCachedSimulation(const SimulationConfig& config, int games, int threads, ResultCache& cache,
+    SimulationStats& stats, int& cachedGames, bool& stored) {
+    clearStats(stats);
+    cachedGames = 0;
+    stored = true;
+
+    SimulationJob* jobs = new SimulationJob[games / CACHE_BLOCK_GAMES + 2];
+    int jobCount = 0;
+    for (int n = 0; n < games;) {
+        unsigned long long seed = config.firstSeed + n;
+        int count = CACHE_BLOCK_GAMES - (int)(seed % CACHE_BLOCK_GAMES);
+        if (count > games - n) count = games - n;
+        const CachedBlock* hit = count == CACHE_BLOCK_GAMES ? findCachedBlock(cache, seed / CACHE_BLOCK_GAMES) : 0;
+        if (hit) {
+            addStats(stats, hit->stats);
+            cachedGames += CACHE_BLOCK_GAMES;
+        }
+        else {
+            SimulationJob& job = jobs[jobCount++];
+            job.config = &config;
+            job.firstGame = n;
+            job.games = count;
+        }
+        n += count;
+    }
+
+    if (threads > jobCount) threads = jobCount;
+    atomic<int> next(0);
+    thread* workers = new thread[threads];
+    for (int t = 1; t < threads; t++) workers[t] = thread(simulateJobs, jobs, jobCount, &next);
+    if (threads > 0) simulateJobs(jobs, jobCount, &next);
+    for (int t = 1; t < threads; t++) workers[t].join();
+    delete[] workers;
+
+    int added = 0;
+    for (int j = 0; j < jobCount; j++) {
+        addStats(stats, jobs[j].stats);
+        if (jobs[j].games == CACHE_BLOCK_GAMES) {
+            addCachedBlock(cache, (config.firstSeed + jobs[j].firstGame) / CACHE_BLOCK_GAMES, jobs[j].stats);
+            added++;
+        }
+    }
+    delete[] jobs;
+    if (added) {
+        stored = cache.path[0] != '\0';
+        if (stored) {
+            readResultCache(cache); // keep the blocks another run stored meanwhile
+            stored = writeResultCache(cache);
+        }
+    }
+}
+
+// uno --simulate <games> [players] [decks] [rules] [agents]
+//     [--threads N] [--seed S] [--batch N] [--lockstep] [--book FILE] [--model FILE]
+//     [--export PREFIX [--csv] [--turns] | --cache DIR]
+// --model lets the endgame solver of e seats score unresolved lines.
+// --cache reuses the totals of whole seed blocks from earlier runs (see
+// Result cache); it cannot be combined with --export, which needs every game.
+// --batch steps N games of a thread together through the turn pipeline, or
+// keeps N in flight on the lockstep engine with --lockstep (default 256).
+int simulateCommand(int argc, char* argv[]) {
+    int games = 1000;
+    int playersCount = 4;
+    int deckCount = 1;
+    int rules = RULES_STANDARD;
+    const char* agentText = 0;
+    int threads = (int)thread::hardware_concurrency();
+    if (threads < 1) threads = 1;
+    unsigned long long seed = (unsigned long long)time(0);
+    const char* exportPrefix = 0;
+    bool csv = false;
+    bool exportTurns = false;
+    int batchSize = 0;
+    bool lockstep = false;
+    const char* bookPath = 0;
+    const char* modelPath = 0;
+    const char* cacheDir = 0;
+
+    bool argsOk = true;
+    int positional = 0;
+    for (int i = 2; i < argc; i++) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (strcmp(arg, "--threads") == 0 && hasValue) threads = atoi(argv[++i]);
+        else if (strcmp(arg, "--batch") == 0 && hasValue) batchSize = atoi(argv[++i]);
+        else if (strcmp(arg, "--cache") == 0 && hasValue) cacheDir = argv[++i];
+        else if (strcmp(arg, "--seed") == 0 && hasValue) seed = strtoull(argv[++i], 0, 10);
+        else if (strcmp(arg, "--export") == 0 && hasValue) exportPrefix = argv[++i];
+        else if (strcmp(arg, "--csv") == 0) csv = true;
+        else if (strcmp(arg, "--turns") == 0) exportTurns = true;
+        else if (strcmp(arg, "--lockstep") == 0) lockstep = true;
+        else if (strcmp(arg, "--book") == 0 && hasValue) bookPath = argv[++i];
+        else if (strcmp(arg, "--model") == 0 && hasValue) modelPath = argv[++i];
+        else if (arg[0] == '-' && arg[1] == '-') argsOk = false;
+        else if (positional == 0) { games = atoi(arg); positional++; }
+        else if (positional == 1) { playersCount = atoi(arg); positional++; }
+        else if (positional == 2) { deckCount = atoi(arg); positional++; }
+        else if (positional == 3) { rules = atoi(arg); positional++; }
+        else if (positional == 4) { agentText = arg; positional++; }
+        else argsOk = false;
+    }
+
+    SimulationConfig config;
+    config.playersCount = playersCount;
+    config.deckCount = deckCount;
+    config.rules = rules;
+    config.firstSeed = seed;
+    if (batchSize == 0) batchSize = lockstep ? LOCKSTEP_BATCH : 1;
+    config.batchSize = batchSize;
+    config.lockstep = lockstep;
+    config.book = 0;
+    config.model = 0;
+    config.gameTable = 0;
+    config.turnTable = 0;
+    for (int i = 0; i < MAX_PLAYERS; i++) config.agents[i] = AGENT_BOT;
+    bool agentsOk = !agentText || parseAgents(agentText, playersCount, config.agents);
+
+    if (!argsOk || games <= 0 || playersCount < MIN_PLAYERS || playersCount > MAX_PLAYERS ||
+        deckCount < 1 || deckCount > MAX_DECKS || rules < 0 || rules >= RULE_COMBINATIONS || !agentsOk ||
+        threads < 1 || threads > MAX_SIMULATION_THREADS || batchSize < 1 || batchSize > GAME_BATCH_SIZE ||
+        (lockstep && !canPlayLockstep(config)) || ((csv || exportTurns) && !exportPrefix) || (cacheDir && exportPrefix)) {
+        cout << "Usage: --simulate <games> [players 2-" << MAX_PLAYERS << "] [decks 1-" << MAX_DECKS
+            << "] [rules 0-" << (RULE_COMBINATIONS - 1) << "] [agents, one of b/e/o/r per seat]\n"
+            << "       [--threads 1-" << MAX_SIMULATION_THREADS << "] [--seed S] [--batch 1-" << GAME_BATCH_SIZE << "]"
+            << " [--lockstep] [--book FILE] [--model FILE]\n"
+            << "       [--export PREFIX [--csv] [--turns] | --cache DIR]\n"
+            << "--lockstep plays rules 0 with b agents only\n";
+        return 1;
+    }
+
+    WinModel model;
+    if (modelPath) {
+        if (!readSolverModel(modelPath, model)) return 1;
+        config.model = &model;
+    }
+    OpeningBook* book = 0;
+    if (bookPath) {
+        book = openOpeningBook(bookPath);
+        if (!book) {
+            cout << "Cannot read opening book " << bookPath << "\n";
+            return 1;
+        }
+        config.book = book;
+    }
+
+    ColumnTable gameTable, turnTable;
+    if (exportPrefix) {
+        if (!openColumnTable(gameTable, exportPrefix, "games", GAME_COLUMNS, GAME_COLUMN_COUNT, csv) ||
+            (exportTurns && !openColumnTable(turnTable, exportPrefix, "turns", TURN_COLUMNS, TURN_COLUMN_COUNT, csv))) {
+            cout << "Cannot write export files with prefix " << exportPrefix << "\n";
+            return 1;
+        }
+        config.gameTable = &gameTable;
+        if (exportTurns) config.turnTable = &turnTable;
+    }
+
+    SimulationStats stats;
+    ResultCache cache;
+    int cachedGames = 0;
+    bool cacheStored = true;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    if (cacheDir) {
+        openResultCache(cache, cacheDir, config);
+        runCachedSimulation(config, games, threads, cache, stats, cachedGames, cacheStored);
+        destroyResultCache(cache);
+    }
+    else runSimulation(config, games, threads, stats);
+    if (config.gameTable) closeColumnTable(gameTable);
+    if (config.turnTable) closeColumnTable(turnTable);
+    if (book) closeOpeningBook(book);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    printSimulationTotals(stats, seed, playersCount);
+    cout << "Arenas allocated: " << stats.arenasCreated << "\n";
+    if (cacheDir) {
+        cout << "Cache: " << cachedGames << " games from " << cache.path << ", " << (games - cachedGames) << " played";
+        if (!cacheStored) cout << " (could not update the cache)";
+        cout << "\n";
+    }
+    if (config.gameTable) {
+        cout << "Exported: " << gameTable.rows << " games";
+        if (config.turnTable) cout << ", " << turnTable.rows << " turns";
+        cout << (csv ? " (csv)" : " (binary columns)") << "\n";
+    }
+    cout << "Threads: " << threads << "\n";
+    cout << "Time: " << seconds << " s";
+    if (seconds > 0) cout << " (" << (int)(stats.games / seconds) << " games/s)";
+    cout << "\n";
+    return 0;
+}
+
+// ---------- Lockstep engine ----------
+// Standard-rules games between default bots, many per thread at once. A
+// batch stores each field of its games in a separate array indexed by the
+// game's slot, and one round advances every game by a turn in a few passes
+// over those arrays. A finished game is retired and its slot is dealt the
+// next game of the job; at the end slots go idle and are masked out.
+//
+// Cards are one-byte kinds ordered by value (value * 4 + color, then the
+// two wilds), so every hand also has a 64-bit mask of the kinds it holds:
+// legality is one AND per game and the bot's choice comes from the highest
+// value set. Hands keep the slot order of the scalar engine, so each game
+// plays exactly as under runGameLoop with the same seed.
+const int LOCKSTEP_KINDS = 54;
+const int LOCKSTEP_WILD = 52;
+const int LOCKSTEP_WILD_PLUS4 = 53;
+const unsigned long long LOCKSTEP_COLORED_KINDS = (1ULL << LOCKSTEP_WILD) - 1;
+const unsigned long long LOCKSTEP_WILD_KINDS = 3ULL << LOCKSTEP_WILD;
+const unsigned long long LOCKSTEP_RED_KINDS = 0x1111111111111ULL; // one bit per value
+
+unsigned char lockstepKind(const Card& c) {
+    if (c.color == WILD) return c.value == WILD_PLUS4 ? LOCKSTEP_WILD_PLUS4 : LOCKSTEP_WILD;
+    return (unsigned char)(c.value * 4 + c.color);
+}
+
+Card lockstepCard(int kind) {
+    Card c;
+    if (kind >= LOCKSTEP_WILD) {
+        c.color = WILD;
+        c.value = kind == LOCKSTEP_WILD ? WILD_CARD : WILD_PLUS4;
+    }
+    else {
+        c.color = (Color)(kind & 3);
+        c.value = (Value)(kind >> 2);
+    }
+    return c;
+}
+
+// The kinds isValidMove accepts on topKind with the given active color.
+unsigned long long lockstepPlayableKinds(int topKind, int activeColor) {
+    unsigned long long sameValue = topKind < LOCKSTEP_WILD ? 0xFULL << (topKind & ~3) : 0;
+    return (LOCKSTEP_RED_KINDS << activeColor) | sameValue | LOCKSTEP_WILD_KINDS;
+}
+
+// The kinds of the highest value present in a mask of colored kinds,
+// without branches (a branching bit search mispredicts on most turns):
+// one bit per value present, smeared down to every lower value, leaves the
+// top value as the only bit not also set one value up.
+unsigned long long highestValueKinds(unsigned long long colored) {
+    unsigned long long values = (colored | colored >> 1 | colored >> 2 | colored >> 3) & LOCKSTEP_RED_KINDS;
+    unsigned long long atOrBelow = values;
+    atOrBelow |= atOrBelow >> 4;
+    atOrBelow |= atOrBelow >> 8;
+    atOrBelow |= atOrBelow >> 16;
+    atOrBelow |= atOrBelow >> 32;
+    unsigned long long top = atOrBelow & ~(atOrBelow >> 4);
+    return colored & (top * 0xF);
+}
+
+// Fields of game slot b live at [b]; fields of seat p in slot b at
+// [b * playersCount + p]. Hands and piles are totalCards bytes per entry.
+struct LockstepBatch {
+    Arena* arena;
+    int width;
+    int playersCount;
+    int totalCards;
+    int live;                   // slots with a game in progress
+
+    unsigned char* running;     // 0 once the slot has gone idle
+    unsigned long long* seed;
+    unsigned long long* rng;
+    unsigned char* topKind;
+    unsigned char* activeColor;
+    signed char* direction;
+    unsigned char* currentPlayer;
+    int* pileStart;
+    int* deckSize;
+    int* discardSize;
+    unsigned char* piles;
+    int* turns;
+    int* refills;
+    int* cardsDrawn;
+    int* actionCardsPlayed;
+
+    short* cardCount;           // per seat
+    unsigned long long* held;   // per seat: kinds in hand
+    unsigned char* kindCounts;  // per seat: LOCKSTEP_KINDS counters
+    unsigned char* hands;       // per seat: totalCards slots
+
+    // This round: the legal kinds and the hand slot to play per game slot,
+    // and the game slots that draw and that play, in the order found.
+    unsigned long long* playable;
+    short* choice;
+    short* drawing;
+    short* playing;
+};
+
+int lockstepArenaBytes(int width, int playersCount, int totalCards) {
+    int seats = width * playersCount;
+    int bytes = 0;
+    bytes += 3 * (width * 8 + 8);                         // seed, rng, playable
+    bytes += 7 * (width * 4 + 8);                         // pile and statistics counters
+    bytes += 5 * (width + 8);                             // running .. currentPlayer
+    bytes += 3 * (width * 2 + 8);                         // choice, drawing, playing
+    bytes += width * totalCards + 8;                      // piles
+    bytes += seats * 2 + 8;                               // cardCount
+    bytes += seats * 8 + 8;                               // held
+    bytes += seats * LOCKSTEP_KINDS + 8;                  // kindCounts
+    bytes += seats * totalCards + 8;                      // hands
+    return bytes;
+}
+
+void createLockstepBatch(LockstepBatch& s, ArenaPool& pool, int width, int playersCount, int totalCards) {
+    int seats = width * playersCount;
+    Arena* a = acquireArena(pool, lockstepArenaBytes(width, playersCount, totalCards));
+    s.arena = a;
+    s.width = width;
+    s.playersCount = playersCount;
+    s.totalCards = totalCards;
+    s.live = 0;
+
+    s.seed = (unsigned long long*)arenaAlloc(*a, width * 8);
+    s.rng = (unsigned long long*)arenaAlloc(*a, width * 8);
+    s.playable = (unsigned long long*)arenaAlloc(*a, width * 8);
+    s.pileStart = (int*)arenaAlloc(*a, width * 4);
+    s.deckSize = (int*)arenaAlloc(*a, width * 4);
+    s.discardSize = (int*)arenaAlloc(*a, width * 4);
+    s.turns = (int*)arenaAlloc(*a, width * 4);
+    s.refills = (int*)arenaAlloc(*a, width * 4);
+    s.cardsDrawn = (int*)arenaAlloc(*a, width * 4);
+    s.actionCardsPlayed = (int*)arenaAlloc(*a, width * 4);
+    s.running = (unsigned char*)arenaAlloc(*a, width);
+    s.topKind = (unsigned char*)arenaAlloc(*a, width);
+    s.activeColor = (unsigned char*)arenaAlloc(*a, width);
+    s.direction = (signed char*)arenaAlloc(*a, width);
+    s.currentPlayer = (unsigned char*)arenaAlloc(*a, width);
+    s.choice = (short*)arenaAlloc(*a, width * 2);
+    s.drawing = (short*)arenaAlloc(*a, width * 2);
+    s.playing = (short*)arenaAlloc(*a, width * 2);
+    s.piles = (unsigned char*)arenaAlloc(*a, width * totalCards);
+    s.cardCount = (short*)arenaAlloc(*a, seats * 2);
+    s.held = (unsigned long long*)arenaAlloc(*a, seats * 8);
+    s.kindCounts = (unsigned char*)arenaAlloc(*a, seats * LOCKSTEP_KINDS);
+    s.hands = (unsigned char*)arenaAlloc(*a, seats * totalCards);
+
+    for (int b = 0; b < width; b++) s.running[b] = 0;
+}
+
+void lockstepAddCard(LockstepBatch& s, int seat, unsigned char kind) {
+    s.hands[seat * s.totalCards + s.cardCount[seat]++] = kind;
+    s.kindCounts[seat * LOCKSTEP_KINDS + kind]++;
+    s.held[seat] |= 1ULL << kind;
+}
+
+// Same slot order as removeCard: the last card fills the gap.
+void lockstepRemoveCard(LockstepBatch& s, int seat, int slot) {
+    unsigned char* hand = s.hands + seat * s.totalCards;
+    unsigned char kind = hand[slot];
+    hand[slot] = hand[--s.cardCount[seat]];
+    unsigned long long gone = --s.kindCounts[seat * LOCKSTEP_KINDS + kind] == 0;
+    s.held[seat] &= ~(gone << kind);
+}
+
+// Ring position pileStart + offset for offset < totalCards, without a division.
+int lockstepRingSlot(const LockstepBatch& s, int b, int offset) {
+    int i = s.pileStart[b] + offset;
+    return i < s.totalCards ? i : i - s.totalCards;
+}
+
+// drawFromDeck and refillDeckFromDiscard on slot b's ring.
+bool lockstepDraw(LockstepBatch& s, int b, unsigned char& kind) {
+    unsigned char* ring = s.piles + b * s.totalCards;
+    if (s.deckSize[b] == 0) {
+        if (s.discardSize[b] == 0) return false;
+        s.deckSize[b] = s.discardSize[b];
+        s.discardSize[b] = 0;
+        s.refills[b]++;
+        for (int i = s.deckSize[b] - 1; i > 0; i--) {
+            int j = randomBelow(s.rng[b], i + 1);
+            unsigned char& x = ring[lockstepRingSlot(s, b, i)];
+            unsigned char& y = ring[lockstepRingSlot(s, b, j)];
+            unsigned char tmp = x;
+            x = y;
+            y = tmp;
+        }
+    }
+    kind = ring[s.pileStart[b]];
+    s.pileStart[b] = lockstepRingSlot(s, b, 1);
+    s.deckSize[b]--;
+    s.cardsDrawn[b]++;
+    return true;
+}
+
+void lockstepNextPlayer(LockstepBatch& s, int b) {
+    int next = s.currentPlayer[b] + s.direction[b];
+    if (next < 0) next += s.playersCount;
+    else if (next >= s.playersCount) next -= s.playersCount;
+    s.currentPlayer[b] = (unsigned char)next;
+}
+
+// botCardChoice with the default weights: the highest colored value, else
+// Wild+4 before Wild; ties go to the first slot in hand.
+int lockstepBotChoice(const LockstepBatch& s, int seat, unsigned long long playable) {
+    unsigned long long colored = playable & LOCKSTEP_COLORED_KINDS;
+    unsigned long long best;
+    if (colored) best = highestValueKinds(colored);
+    else best = playable & (1ULL << LOCKSTEP_WILD_PLUS4) ? 1ULL << LOCKSTEP_WILD_PLUS4 : 1ULL << LOCKSTEP_WILD;
+
+    const unsigned char* hand = s.hands + seat * s.totalCards;
+    int slot = 0;
+    while (!((best >> hand[slot]) & 1)) slot++;
+    return slot;
+}
+
+// botColorChoice with the default weights: the most frequent color in hand.
+int lockstepColorChoice(const LockstepBatch& s, int seat) {
+    const unsigned char* counts = s.kindCounts + seat * LOCKSTEP_KINDS;
+    int scores[4] = { 0, 0, 0, 0 };
+    for (int k = 0; k < LOCKSTEP_WILD; k++) scores[k & 3] += counts[k];
+    int best = 0;
+    for (int c = 1; c < 4; c++) {
+        if (scores[c] > scores[best]) best = c;
+    }
+    return best;
+}
+
+// resolvePlayedCard<RULES_STANDARD> for hand slot `slot` of slot b's
+// current player. Returns true when that player has won.
+bool lockstepPlay(LockstepBatch& s, int b, int slot) {
+    int seat = b * s.playersCount + s.currentPlayer[b];
+    unsigned char kind = s.hands[seat * s.totalCards + slot];
+
+    s.piles[b * s.totalCards + lockstepRingSlot(s, b, s.deckSize[b] + s.discardSize[b]++)] = s.topKind[b];
+    s.topKind[b] = kind;
+    lockstepRemoveCard(s, seat, slot);
+    if (kind < LOCKSTEP_WILD) s.activeColor[b] = kind & 3;
+    else s.activeColor[b] = (unsigned char)lockstepColorChoice(s, seat);
+
+    int value = kind < LOCKSTEP_WILD ? kind >> 2 : WILD_CARD + kind - LOCKSTEP_WILD;
+    s.actionCardsPlayed[b] += value >= SKIP;
+    if (s.cardCount[seat] == 0) return true;
+
+    // Effects are folded into the direction and the number of seats to
+    // move on, so only the draw itself is a branch.
+    bool reverse = value == REVERSE;
+    bool twoPlayers = s.playersCount == 2;
+    int drawCount = value == PLUS2 ? 2 : value == WILD_PLUS4 ? 4 : 0;
+    bool skip = value == SKIP || (reverse && twoPlayers) || drawCount > 0;
+    s.direction[b] = (signed char)(reverse && !twoPlayers ? -s.direction[b] : s.direction[b]);
+
+    lockstepNextPlayer(s, b);
+    if (drawCount > 0) {
+        int victim = b * s.playersCount + s.currentPlayer[b];
+        unsigned char drawn;
+        for (int i = 0; i < drawCount && lockstepDraw(s, b, drawn); i++) lockstepAddCard(s, victim, drawn);
+    }
+    int next = s.currentPlayer[b];
+    lockstepNextPlayer(s, b);
+    s.currentPlayer[b] = (unsigned char)(skip ? s.currentPlayer[b] : next);
+    return false;
+}
+
+struct LockstepRun {
+    const SimulationConfig* config;
+    unsigned char deck[MAX_DECKS * CARDS_PER_DECK]; // buildGameDeck order, as kinds
+    SimulationStats* stats;
+    ColumnBuffer* gameLog;      // may be null
+    ColumnBuffer* turnLog;      // may be null
+    unsigned long long nextSeed;
+    int gamesLeft;              // not dealt yet
+};
+
+// Deals the next game of the run into slot b: newShuffledDeck,
+// dealInitialCards and startTopCard on kinds, with the same generator
+// calls, so the game starts exactly as setupSilentGame would start it.
+void dealLockstepGame(LockstepBatch& s, int b, LockstepRun& run) {
+    unsigned long long seed = run.nextSeed++;
+    run.gamesLeft--;
+
+    s.running[b] = 1;
+    s.seed[b] = seed;
+    s.rng[b] = seed;
+    s.direction[b] = 1;
+    s.currentPlayer[b] = 0;
+    s.turns[b] = 0;
+    s.refills[b] = 0;
+    s.actionCardsPlayed[b] = 0;
+
+    unsigned char* ring = s.piles + b * s.totalCards;
+    memcpy(ring, run.deck, s.totalCards);
+    for (int i = s.totalCards - 1; i > 0; i--) {
+        int j = randomBelow(s.rng[b], i + 1);
+        unsigned char tmp = ring[i];
+        ring[i] = ring[j];
+        ring[j] = tmp;
+    }
+
+    // Seven rounds always fit in one deck (MAX_PLAYERS * 7 < CARDS_PER_DECK).
+    for (int p = 0; p < s.playersCount; p++) {
+        int seat = b * s.playersCount + p;
+        s.cardCount[seat] = 0;
+        s.held[seat] = 0;
+        memset(s.kindCounts + seat * LOCKSTEP_KINDS, 0, LOCKSTEP_KINDS);
+    }
+    int dealt = 0;
+    for (int r = 0; r < 7; r++) {
+        for (int p = 0; p < s.playersCount; p++) lockstepAddCard(s, b * s.playersCount + p, ring[dealt++]);
+    }
+    s.pileStart[b] = dealt;
+    s.deckSize[b] = s.totalCards - dealt;
+    s.discardSize[b] = 0;
+    s.cardsDrawn[b] = dealt;
+
+    unsigned char kind;
+    while (lockstepDraw(s, b, kind)) {
+        if (kind < LOCKSTEP_WILD) {
+            s.topKind[b] = kind;
+            s.activeColor[b] = kind & 3;
+            return;
+        }
+        ring[lockstepRingSlot(s, b, s.deckSize[b] + s.discardSize[b]++)] = kind;
+    }
+    s.topKind[b] = 0; // red zero, as in startTopCard
+    s.activeColor[b] = RED;
+}
+
+// Counts the game in slot b (winner -1 = unfinished) and deals the next
+// one into the slot, or lets it go idle.
+void retireLockstepGame(LockstepBatch& s, int b, int winner, LockstepRun& run) {
+    SimulationStats& stats = *run.stats;
+    stats.games++;
+    stats.turns += s.turns[b];
+    if (winner >= 0) stats.wins[winner]++;
+    else stats.unfinished++;
+    if (run.gameLog) {
+        long long row[GAME_COLUMN_COUNT] = {
+            (long long)s.seed[b], s.playersCount, winner, s.turns[b],
+            s.refills[b], s.cardsDrawn[b], s.actionCardsPlayed[b], 0
+        };
+        appendRow(*run.gameLog, row);
+    }
+
+    if (run.gamesLeft > 0) {
+        dealLockstepGame(s, b, run);
+    }
+    else {
+        s.running[b] = 0;
+        s.live--;
+    }
+}
+
+// One turn of every running game. Each pass works through a list of the
+// game slots it applies to, so no pass branches on which games take part.
+void stepLockstepBatch(LockstepBatch& s, LockstepRun& run) {
+    int width = s.width;
+    int players = s.playersCount;
+
+    // Observe: count the turn, find the legal kinds in the current hand and
+    // sort the game into the drawing or the playing list.
+    int drawCount = 0;
+    int playCount = 0;
+    for (int b = 0; b < width; b++) {
+        unsigned long long hand = s.held[b * players + s.currentPlayer[b]];
+        unsigned long long playable = hand & lockstepPlayableKinds(s.topKind[b], s.activeColor[b]);
+        int running = s.running[b];
+        s.playable[b] = playable;
+        s.turns[b] += running;
+        s.drawing[drawCount] = (short)b;
+        s.playing[playCount] = (short)b;
+        drawCount += running & (playable == 0);
+        playCount += running & (playable != 0);
+    }
+    if (run.turnLog) {
+        for (int b = 0; b < width; b++) {
+            if (!s.running[b]) continue;
+            long long row[TURN_COLUMN_COUNT] = {
+                (long long)s.seed[b], s.turns[b], s.currentPlayer[b], s.cardCount[b * players + s.currentPlayer[b]],
+                cardKind(lockstepCard(s.topKind[b])), s.activeColor[b]
+            };
+            appendRow(*run.turnLog, row);
+        }
+    }
+
+    // Decide for the games with a legal card in hand.
+    for (int i = 0; i < playCount; i++) {
+        int b = s.playing[i];
+        s.choice[b] = (short)lockstepBotChoice(s, b * players + s.currentPlayer[b], s.playable[b]);
+    }
+
+    // Draw where nothing is playable; a playable drawn card is played.
+    for (int i = 0; i < drawCount; i++) {
+        int b = s.drawing[i];
+        int seat = b * players + s.currentPlayer[b];
+        unsigned char drawn;
+        if (!lockstepDraw(s, b, drawn)) {
+            retireLockstepGame(s, b, -1, run);
+            continue;
+        }
+        lockstepAddCard(s, seat, drawn);
+        if ((lockstepPlayableKinds(s.topKind[b], s.activeColor[b]) >> drawn) & 1) {
+            s.choice[b] = s.cardCount[seat] - 1;
+            s.playing[playCount++] = (short)b;
+        }
+        else {
+            lockstepNextPlayer(s, b);
+        }
+    }
+
+    // Resolve.
+    for (int i = 0; i < playCount; i++) {
+        int b = s.playing[i];
+        int player = s.currentPlayer[b];
+        if (lockstepPlay(s, b, s.choice[b])) retireLockstepGame(s, b, player, run);
+    }
+}
+
+// Plays games firstGame .. firstGame + games - 1 of the simulation with up
+// to width of them in flight, adding them to stats and the logs.
+void playLockstepGames(const SimulationConfig& config, int firstGame, int games, int width, ArenaPool& pool,
+    SimulationStats& stats, ColumnBuffer* gameLog, ColumnBuffer* turnLog) {
+    LockstepRun run;
+    run.config = &config;
+    Card deck[MAX_DECKS * CARDS_PER_DECK];
+    int deckSize;
+    buildGameDeck(deck, deckSize, config.deckCount);
+    for (int i = 0; i < deckSize; i++) run.deck[i] = lockstepKind(deck[i]);
+    run.stats = &stats;
+    run.gameLog = gameLog;
+    run.turnLog = turnLog;
+    run.nextSeed = config.firstSeed + firstGame;
+    run.gamesLeft = games;
+
+    if (width > games) width = games;
+    LockstepBatch s;
+    createLockstepBatch(s, pool, width, config.playersCount, config.deckCount * CARDS_PER_DECK);
+    for (int b = 0; b < width; b++) {
+        dealLockstepGame(s, b, run);
+        s.live++;
+    }
+    while (s.live > 0) stepLockstepBatch(s, run);
+    releaseArena(pool, s.arena);
+}
+
+// The lockstep engine covers standard rules between default bots.
+bool canPlayLockstep(const SimulationConfig& config) {
+    if (config.rules != RULES_STANDARD) return false;
+    for (int i = 0; i < config.playersCount; i++) {
+        if (config.agents[i] != AGENT_BOT) return false;
+    }
+    return true;
+}
+
+// ---------- Evaluation ----------
+// Duplicate-format comparison of two agents. Every deal (one seed) is played
+// once per seat with agent A in that seat and agent B in all others, so both
+// agents see the same hands and draw piles and most of the luck cancels out.
+// The score of a deal is A's win rate minus B's per-seat win rate over its
+// rotations; the mean over deals is the reported delta.
+const int EVALUATION_BATCH_DEALS = 100;
+
+struct AgentSpec {
+    AgentKind agent;
+    BotWeights weights;
+};
+
+struct EvaluationTotals {
+    int deals;
+    double sum;        // of per-deal deltas
+    double sumSquares;
+    long long winsA;
+    long long winsB;
+    long long unfinished;
+};
+
+struct EvaluationJob {
+    const SimulationConfig* config;
+    const AgentSpec* a;
+    const AgentSpec* b;
+    unsigned long long firstSeed;
+    int deals;
+    EvaluationTotals totals;
+};
+
+void evaluateDeals(EvaluationJob* job) {
+    const SimulationConfig& config = *job->config;
+    EvaluationTotals& totals = job->totals;
+    int n = config.playersCount;
+    ArenaPool pool = {};
+    ostream silent(0);
+    EndgameSolver* solver = 0;
+    if (job->a->agent == AGENT_ENDGAME || job->b->agent == AGENT_ENDGAME) solver = createEndgameSolver();
+    if (solver) solver->model = config.model;
+
+    totals.deals = job->deals;
+    totals.sum = 0;
+    totals.sumSquares = 0;
+    totals.winsA = 0;
+    totals.winsB = 0;
+    totals.unfinished = 0;
+
+    AgentKind agents[MAX_PLAYERS];
+    const BotWeights* weights[MAX_PLAYERS];
+    for (int d = 0; d < job->deals; d++) {
+        int winsA = 0, winsB = 0;
+        for (int seat = 0; seat < n; seat++) {
+            for (int i = 0; i < n; i++) {
+                const AgentSpec& spec = i == seat ? *job->a : *job->b;
+                agents[i] = spec.agent;
+                weights[i] = &spec.weights;
+            }
+
+            GameState g = {};
+            playSilentGame(g, pool, config, agents, weights, job->firstSeed + d, silent, solver, 0);
+            if (g.winner == seat) winsA++;
+            else if (g.winner >= 0) winsB++;
+            else totals.unfinished++;
+            destroyGame(g, pool);
+        }
+
+        double delta = ((double)winsA - (double)winsB / (n - 1)) / n;
+        totals.sum += delta;
+        totals.sumSquares += delta * delta;
+        totals.winsA += winsA;
+        totals.winsB += winsB;
+    }
+
+    destroyArenaPool(pool);
+    if (solver) destroyEndgameSolver(solver);
+}
+
+// Plays deals firstSeed.. firstSeed + deals - 1 split over threads and adds
+// them to totals. The sums do not depend on the split.
+void runEvaluationBatch(const SimulationConfig& config, const AgentSpec& a, const AgentSpec& b,
+    unsigned long long firstSeed, int deals, int threads, EvaluationTotals& totals) {
+    if (threads > deals) threads = deals;
+    EvaluationJob* jobs = new EvaluationJob[threads];
+    thread* workers = new thread[threads];
+
+    int first = 0;
+    for (int t = 0; t < threads; t++) {
+        jobs[t].config = &config;
+        jobs[t].a = &a;
+        jobs[t].b = &b;
+        jobs[t].firstSeed = firstSeed + first;
+        jobs[t].deals = deals / threads + (t < deals % threads ? 1 : 0);
+        first += jobs[t].deals;
+        if (t > 0) workers[t] = thread(evaluateDeals, &jobs[t]);
+    }
+    evaluateDeals(&jobs[0]);
+
+    for (int t = 0; t < threads; t++) {
+        if (t > 0) workers[t].join();
+        const EvaluationTotals& s = jobs[t].totals;
+        totals.deals += s.deals;
+        totals.sum += s.sum;
+        totals.sumSquares += s.sumSquares;
+        totals.winsA += s.winsA;
+        totals.winsB += s.winsB;
+        totals.unfinished += s.unfinished;
+    }
+
+    delete[] workers;
+    delete[] jobs;
+}
+
+double evaluationMean(const EvaluationTotals& t) {
+    return t.deals > 0 ? t.sum / t.deals : 0;
+}
+
+double evaluationStandardError(const EvaluationTotals& t) {
+    if (t.deals < 2) return 0;
+    double mean = evaluationMean(t);
+    double variance = (t.sumSquares - t.deals * mean * mean) / (t.deals - 1);
+    return variance > 0 ? sqrt(variance / t.deals) : 0;
+}
+
+// b or e, optionally followed by :w1,w2,... with BOT_WEIGHT_COUNT weights.
+bool parseAgent(const char* text, AgentSpec& spec) {
+    if (text[0] == 'b') spec.agent = AGENT_BOT;
+    else if (text[0] == 'e') spec.agent = AGENT_ENDGAME;
+    else if (text[0] == 'o') spec.agent = AGENT_BOOK;
+    else return false;
+    spec.weights = DEFAULT_BOT_WEIGHTS;
+    if (text[1] == 0) return true;
+    if (text[1] != ':') return false;
+
+    const char* p = text + 2;
+    for (int i = 0; i < BOT_WEIGHT_COUNT; i++) {
+        char* end;
+        spec.weights.w[i] = strtod(p, &end);
+        if (end == p) return false;
+        if (i < BOT_WEIGHT_COUNT - 1 && *end != ',') return false;
+        p = end + 1;
+    }
+    return p[-1] == 0;
+}
+
+void printAgentSpec(ostream& out, const AgentSpec& spec) {
+    out << (spec.agent == AGENT_ENDGAME ? 'e' : spec.agent == AGENT_BOOK ? 'o' : 'b') << ':';
+    for (int i = 0; i < BOT_WEIGHT_COUNT; i++) out << (i ? "," : "") << spec.weights.w[i];
+}
+
+// uno --evaluate <agentA> <agentB> [players] [decks] [rules]
+//     [--deals N] [--seed S] [--threads N] [--confidence 90|95|99] [--book FILE] [--model FILE]
+//
+// Deals are played in batches. After each batch the interval is checked
+// against an O'Brien-Fleming style bound (z * sqrt(looks / look)), which is
+// strict early on so that repeated looks do not inflate false positives;
+// the run stops as soon as the interval excludes zero.
+int evaluateCommand(int argc, char* argv[]) {
+    AgentSpec a, b;
+    parseAgent("e", a);
+    parseAgent("b", b);
+    int playersCount = 2;
+    int deckCount = 1;
+    int rules = RULES_STANDARD;
+    int maxDeals = 20000;
+    int threads = (int)thread::hardware_concurrency();
+    if (threads < 1) threads = 1;
+    unsigned long long seed = (unsigned long long)time(0);
+    int confidence = 95;
+    const char* bookPath = 0;
+    const char* modelPath = 0;
+
+    bool argsOk = true;
+    int positional = 0;
+    for (int i = 2; i < argc; i++) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (strcmp(arg, "--deals") == 0 && hasValue) maxDeals = atoi(argv[++i]);
+        else if (strcmp(arg, "--seed") == 0 && hasValue) seed = strtoull(argv[++i], 0, 10);
+        else if (strcmp(arg, "--threads") == 0 && hasValue) threads = atoi(argv[++i]);
+        else if (strcmp(arg, "--confidence") == 0 && hasValue) confidence = atoi(argv[++i]);
+        else if (strcmp(arg, "--book") == 0 && hasValue) bookPath = argv[++i];
+        else if (strcmp(arg, "--model") == 0 && hasValue) modelPath = argv[++i];
+        else if (arg[0] == '-' && arg[1] == '-') argsOk = false;
+        else if (positional == 0) { argsOk = argsOk && parseAgent(arg, a); positional++; }
+        else if (positional == 1) { argsOk = argsOk && parseAgent(arg, b); positional++; }
+        else if (positional == 2) { playersCount = atoi(arg); positional++; }
+        else if (positional == 3) { deckCount = atoi(arg); positional++; }
+        else if (positional == 4) { rules = atoi(arg); positional++; }
+        else argsOk = false;
+    }
+
+    double z = confidence == 90 ? 1.645 : confidence == 95 ? 1.960 : confidence == 99 ? 2.576 : 0;
+    if (!argsOk || positional < 2 || playersCount < MIN_PLAYERS || playersCount > MAX_PLAYERS ||
+        deckCount < 1 || deckCount > MAX_DECKS || rules < 0 || rules >= RULE_COMBINATIONS ||
+        maxDeals < 2 || threads < 1 || threads > MAX_SIMULATION_THREADS || z == 0) {
+        cout << "Usage: --evaluate <agentA> <agentB> [players 2-" << MAX_PLAYERS << "] [decks 1-"
+            << MAX_DECKS << "] [rules 0-" << (RULE_COMBINATIONS - 1) << "]\n"
+            << "       [--deals N] [--seed S] [--threads 1-" << MAX_SIMULATION_THREADS
+            << "] [--confidence 90|95|99] [--book FILE] [--model FILE]\n"
+            << "Agents are b (bot), e (endgame bot) or o (bot with the --book opening book),\n"
+            << "optionally with weights as b:w1,...,w"
+            << BOT_WEIGHT_COUNT << "\n";
+        return 1;
+    }
+
+    SimulationConfig config = {};
+    config.playersCount = playersCount;
+    config.deckCount = deckCount;
+    config.rules = rules;
+    WinModel model;
+    if (modelPath) {
+        if (!readSolverModel(modelPath, model)) return 1;
+        config.model = &model;
+    }
+    OpeningBook* book = 0;
+    if (bookPath) {
+        book = openOpeningBook(bookPath);
+        if (!book) {
+            cout << "Cannot read opening book " << bookPath << "\n";
+            return 1;
+        }
+        config.book = book;
+    }
+
+    EvaluationTotals totals = {};
+    int looks = (maxDeals + EVALUATION_BATCH_DEALS - 1) / EVALUATION_BATCH_DEALS;
+    bool significant = false;
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int look = 1; totals.deals < maxDeals && !significant; look++) {
+        int batch = maxDeals - totals.deals;
+        if (batch > EVALUATION_BATCH_DEALS) batch = EVALUATION_BATCH_DEALS;
+        runEvaluationBatch(config, a, b, seed + totals.deals, batch, threads, totals);
+
+        double mean = evaluationMean(totals);
+        double standardError = evaluationStandardError(totals);
+        double bound = z * sqrt((double)looks / look) * standardError;
+        significant = totals.deals < maxDeals && standardError > 0 && fabs(mean) > bound;
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (book) closeOpeningBook(book);
+
+    double mean = evaluationMean(totals);
+    double halfWidth = z * evaluationStandardError(totals);
+    long long games = (long long)totals.deals * playersCount;
+    cout << "Deals: " << totals.deals << " (" << games << " games, " << totals.unfinished
+        << " unfinished), seed " << seed << "\n";
+    cout << "A win rate: " << 100.0 * totals.winsA / games << "%\n";
+    cout << "B win rate per seat: " << 100.0 * totals.winsB / games / (playersCount - 1) << "%\n";
+    cout << "Delta (A - B): " << (mean >= 0 ? "+" : "") << 100.0 * mean << "% +/- "
+        << 100.0 * halfWidth << "% (" << confidence << "% CI)\n";
+    if (significant) cout << "Stopped early: the difference is significant\n";
+    else if (fabs(mean) > halfWidth) cout << "Significant at the deal limit\n";
+    else cout << "No significant difference within " << maxDeals << " deals\n";
+    cout << "Time: " << seconds << " s";
+    if (seconds > 0) cout << " (" << (int)(games / seconds) << " games/s)";
+    cout << "\n";
+    return 0;
+}
+
+// ---------- Tuning ----------
+// SPSA over the bot weights. Each iteration perturbs all weights at once by
+// +/- c_k (a random sign per weight), plays the two perturbed bots against
+// each other on paired deals, and steps along the estimated gradient of the
+// win-rate delta. Weights are searched in units of TUNING_SCALE, so one step
+// means a comparable change for every weight.
+const double TUNING_SCALE[BOT_WEIGHT_COUNT] = { 1, 10, 5, 0.5, 5, 0.5 };
+const double TUNING_STEP = 40;       // a: gain of the update
+const double TUNING_PERTURBATION = 1; // c: size of the +/- probe
+const double TUNING_STABILITY = 10;  // A: damps the first steps
+
+// uno --tune [iterations] [players] [decks] [rules]
+//     [--deals N] [--seed S] [--threads N] [--from b:w1,...]
+int tuneCommand(int argc, char* argv[]) {
+    int iterations = 100;
+    int playersCount = 2;
+    int deckCount = 1;
+    int rules = RULES_STANDARD;
+    int deals = 1000;
+    int threads = (int)thread::hardware_concurrency();
+    if (threads < 1) threads = 1;
+    unsigned long long seed = (unsigned long long)time(0);
+    AgentSpec start;
+    parseAgent("b", start);
+
+    bool argsOk = true;
+    int positional = 0;
+    for (int i = 2; i < argc; i++) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (strcmp(arg, "--deals") == 0 && hasValue) deals = atoi(argv[++i]);
+        else if (strcmp(arg, "--seed") == 0 && hasValue) seed = strtoull(argv[++i], 0, 10);
+        else if (strcmp(arg, "--threads") == 0 && hasValue) threads = atoi(argv[++i]);
+        else if (strcmp(arg, "--from") == 0 && hasValue) argsOk = argsOk && parseAgent(argv[++i], start);
+        else if (arg[0] == '-' && arg[1] == '-') argsOk = false;
+        else if (positional == 0) { iterations = atoi(arg); positional++; }
+        else if (positional == 1) { playersCount = atoi(arg); positional++; }
+        else if (positional == 2) { deckCount = atoi(arg); positional++; }
+        else if (positional == 3) { rules = atoi(arg); positional++; }
+        else argsOk = false;
+    }
+
+    if (!argsOk || iterations < 1 || playersCount < MIN_PLAYERS || playersCount > MAX_PLAYERS ||
+        deckCount < 1 || deckCount > MAX_DECKS || rules < 0 || rules >= RULE_COMBINATIONS ||
+        deals < 2 || threads < 1 || threads > MAX_SIMULATION_THREADS) {
+        cout << "Usage: --tune [iterations] [players 2-" << MAX_PLAYERS << "] [decks 1-" << MAX_DECKS
+            << "] [rules 0-" << (RULE_COMBINATIONS - 1) << "]\n"
+            << "       [--deals N] [--seed S] [--threads 1-" << MAX_SIMULATION_THREADS
+            << "] [--from b:w1,...,w" << BOT_WEIGHT_COUNT << "]\n";
+        return 1;
+    }
+
+    SimulationConfig config = {};
+    config.playersCount = playersCount;
+    config.deckCount = deckCount;
+    config.rules = rules;
+
+    AgentSpec current = start;
+    unsigned long long rng = seed;
+    unsigned long long nextSeed = seed;
+    long long totalGames = 0;
+    chrono::steady_clock::time_point runStart = chrono::steady_clock::now();
+
+    for (int k = 0; k < iterations; k++) {
+        double ak = TUNING_STEP / pow(k + 1 + TUNING_STABILITY, 0.602);
+        double ck = TUNING_PERTURBATION / pow(k + 1, 0.101);
+
+        int signs[BOT_WEIGHT_COUNT];
+        AgentSpec plus = current, minus = current;
+        for (int i = 0; i < BOT_WEIGHT_COUNT; i++) {
+            signs[i] = (splitMix64(rng) & 1) ? 1 : -1;
+            plus.weights.w[i] += ck * signs[i] * TUNING_SCALE[i];
+            minus.weights.w[i] -= ck * signs[i] * TUNING_SCALE[i];
+        }
+
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        EvaluationTotals totals = {};
+        runEvaluationBatch(config, plus, minus, nextSeed, deals, threads, totals);
+        nextSeed += deals;
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        double delta = evaluationMean(totals);
+        for (int i = 0; i < BOT_WEIGHT_COUNT; i++) {
+            current.weights.w[i] += ak * delta / (2 * ck * signs[i]) * TUNING_SCALE[i];
+        }
+
+        long long games = (long long)deals * playersCount;
+        totalGames += games;
+        cout << "Iteration " << (k + 1) << "/" << iterations << ": delta " << (delta >= 0 ? "+" : "")
+            << 100.0 * delta << "%, ";
+        if (seconds > 0) cout << (int)(games / seconds) << " games/s, ";
+        printAgentSpec(cout, current);
+        cout << "\n";
+    }
+
+    // Check the result on fresh deals against the starting weights.
+    EvaluationTotals check = {};
+    runEvaluationBatch(config, current, start, nextSeed, deals * 4, threads, check);
+    totalGames += (long long)check.deals * playersCount;
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - runStart).count();
+
+    cout << "Tuned weights:";
+    for (int i = 0; i < BOT_WEIGHT_COUNT; i++) cout << " " << BOT_WEIGHT_NAMES[i] << "=" << current.weights.w[i];
+    cout << "\nAgent: ";
+    printAgentSpec(cout, current);
+    cout << "\nTuned vs start: " << (evaluationMean(check) >= 0 ? "+" : "") << 100.0 * evaluationMean(check)
+        << "% +/- " << 100.0 * 1.96 * evaluationStandardError(check) << "% (95% CI, "
+        << check.deals << " deals)\n";
+    cout << "Games: " << totalGames << ", time: " << seconds << " s";
+    if (seconds > 0) cout << " (" << (int)(totalGames / seconds) << " games/s)";
+    cout << "\n";
+    return 0;
+}
+
+// ---------- Opening book generation ----------
+// uno --build-book <file> [games] [rules] [--decks N] [--min-samples N] [--threads N] [--seed S]
+// Bots play games at 2 to MAX_PLAYERS seats. In each seat's first
+// BOOK_ROUNDS plays, whenever more than one class of move is playable, the
+// class is drawn at random and credited with a win if that seat wins. The
+// book keeps, per key, the class with the best win rate among those tried
+// at least min-samples times. Game n uses seed + n for the deal and the
+// draws, so the book does not depend on the number of threads.
+const int BOOK_MIN_SAMPLES = 200;
+
+struct BookCounts {
+    long long plays[BOOK_KEYS][BOOK_MOVES];
+    long long wins[BOOK_KEYS][BOOK_MOVES];
+};
+
+struct BookJob {
+    int rules;
+    int decks;
+    unsigned long long firstSeed;
+    int firstGame;
+    int games;
+    BookCounts* counts;
+    long long decisions;
+};
+
+void playBookGames(BookJob* job) {
+    ArenaPool pool = {};
+    ostream silent(0);
+    SimulationConfig config = {};
+    config.deckCount = job->decks;
+    config.rules = job->rules;
+    for (int i = 0; i < MAX_PLAYERS; i++) config.agents[i] = AGENT_BOT;
+    const GameEngine& engine = gameEngine(job->rules);
+
+    const int maxDecisions = BOOK_ROUNDS * MAX_PLAYERS;
+    int keys[maxDecisions], moves[maxDecisions], seats[maxDecisions];
+    job->decisions = 0;
+
+    for (int n = 0; n < job->games; n++) {
+        int game = job->firstGame + n;
+        unsigned long long seed = job->firstSeed + game;
+        config.playersCount = MIN_PLAYERS + game % (MAX_PLAYERS - MIN_PLAYERS + 1);
+
+        GameState g = {};
+        setupSilentGame(g, pool, config, config.agents, 0, seed, silent, 0, 0);
+        unsigned long long explore = seed ^ 0x9E3779B97F4A7C15ULL; // the deal's own generator stays untouched
+        int count = 0;
+        while (true) {
+            TurnPhase phase = engine.observe(g);
+            int choice = -1;
+            if (phase == PHASE_PLAY && inBookRounds(g, BOOK_ROUNDS) && count < maxDecisions) {
+                int available[BOOK_MOVES];
+                int options = availableBookMoves(g, available);
+                if (options > 1) {
+                    int move = available[randomBelow(explore, options)];
+                    keys[count] = bookKey(g);
+                    moves[count] = move;
+                    seats[count] = g.currentPlayer;
+                    count++;
+                    choice = bookMoveCard(g, move);
+                }
+            }
+            if (choice < 0) choice = decideTurn(g, phase);
+            if (engine.resolve(g, phase, choice)) break;
+        }
+
+        for (int i = 0; i < count; i++) {
+            job->counts->plays[keys[i]][moves[i]]++;
+            if (g.winner == seats[i]) job->counts->wins[keys[i]][moves[i]]++;
+        }
+        job->decisions += count;
+        destroyGame(g, pool);
+    }
+    destroyArenaPool(pool);
+}
+
+// Writes the book through a temporary file, like the save files.
+bool writeOpeningBook(const char* path, int rules, int decks, const unsigned char moves[]) {
+    BookHeader h;
+    memcpy(h.magic, BOOK_MAGIC, sizeof(BOOK_MAGIC));
+    h.version = BOOK_VERSION;
+    h.rules = rules;
+    h.decks = decks;
+    h.rounds = BOOK_ROUNDS;
+    h.keys = BOOK_KEYS;
+
+    char temp[512];
+    if (snprintf(temp, sizeof(temp), "%s.tmp", path) >= (int)sizeof(temp)) return false;
+    FILE* f = fopen(temp, "wb");
+    if (!f) return false;
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1 && fwrite(moves, 1, BOOK_KEYS, f) == (size_t)BOOK_KEYS &&
+        fflush(f) == 0 && syncFile(f);
+    if (fclose(f) != 0) ok = false;
+    if (ok) ok = replaceFile(temp, path);
+    if (!ok) remove(temp);
+    return ok;
+}
+
+int buildBookCommand(int argc, char* argv[]) {
+    const char* path = 0;
+    int games = 1000000;
+    int rules = RULES_STANDARD;
+    int decks = 1;
+    int minSamples = BOOK_MIN_SAMPLES;
+    int threads = (int)thread::hardware_concurrency();
+    if (threads < 1) threads = 1;
+    unsigned long long seed = 1;
+
+    bool argsOk = true;
+    int positional = 0;
+    for (int i = 2; i < argc; i++) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (strcmp(arg, "--decks") == 0 && hasValue) decks = atoi(argv[++i]);
+        else if (strcmp(arg, "--min-samples") == 0 && hasValue) minSamples = atoi(argv[++i]);
+        else if (strcmp(arg, "--threads") == 0 && hasValue) threads = atoi(argv[++i]);
+        else if (strcmp(arg, "--seed") == 0 && hasValue) seed = strtoull(argv[++i], 0, 10);
+        else if (arg[0] == '-' && arg[1] == '-') argsOk = false;
+        else if (positional == 0) { path = arg; positional++; }
+        else if (positional == 1) { games = atoi(arg); positional++; }
+        else if (positional == 2) { rules = atoi(arg); positional++; }
+        else argsOk = false;
+    }
+    if (!argsOk || !path || games <= 0 || rules < 0 || rules >= RULE_COMBINATIONS || decks < 1 ||
+        decks > MAX_DECKS || minSamples < 1 || threads < 1 || threads > MAX_SIMULATION_THREADS) {
+        cout << "Usage: --build-book <file> [games] [rules 0-" << (RULE_COMBINATIONS - 1)
+            << "] [--decks 1-" << MAX_DECKS << "] [--min-samples N] [--threads 1-" << MAX_SIMULATION_THREADS << "] [--seed S]\n";
+        return 1;
+    }
+    if (threads > games) threads = games;
+
+    BookJob* jobs = new BookJob[threads];
+    thread* workers = new thread[threads];
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int t = 0; t < threads; t++) {
+        BookJob& job = jobs[t];
+        job.rules = rules;
+        job.decks = decks;
+        job.firstSeed = seed;
+        job.firstGame = (int)((long long)games * t / threads);
+        job.games = (int)((long long)games * (t + 1) / threads) - job.firstGame;
+        job.counts = new BookCounts();
+        workers[t] = thread(playBookGames, &job);
+    }
+    for (int t = 0; t < threads; t++) workers[t].join();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    BookCounts& total = *jobs[0].counts;
+    long long decisions = jobs[0].decisions;
+    for (int t = 1; t < threads; t++) {
+        for (int k = 0; k < BOOK_KEYS; k++) {
+            for (int m = 0; m < BOOK_MOVES; m++) {
+                total.plays[k][m] += jobs[t].counts->plays[k][m];
+                total.wins[k][m] += jobs[t].counts->wins[k][m];
+            }
+        }
+        decisions += jobs[t].decisions;
+    }
+
+    // A key gets an entry only when at least two classes were tried enough.
+    unsigned char* moves = new unsigned char[BOOK_KEYS];
+    int entries = 0;
+    for (int k = 0; k < BOOK_KEYS; k++) {
+        moves[k] = BOOK_NO_MOVE;
+        int tried = 0;
+        double bestRate = -1;
+        for (int m = 0; m < BOOK_MOVES; m++) {
+            if (total.plays[k][m] < minSamples) continue;
+            tried++;
+            double rate = (double)total.wins[k][m] / total.plays[k][m];
+            if (rate > bestRate) {
+                bestRate = rate;
+                moves[k] = (unsigned char)m;
+            }
+        }
+        if (tried < 2) moves[k] = BOOK_NO_MOVE;
+        else entries++;
+    }
+
+    bool ok = writeOpeningBook(path, rules, decks, moves);
+    cout << "Games: " << games << " (seed " << seed << "), " << decisions << " opening decisions\n";
+    cout << "Book entries: " << entries << " of " << BOOK_KEYS << " keys (rules " << rules << ", " << decks << " deck"
+        << (decks == 1 ? "" : "s") << ")\n";
+    cout << "Time: " << seconds << " s\n";
+    if (!ok) cout << "Cannot write " << path << "\n";
+
+    delete[] moves;
+    for (int t = 0; t < threads; t++) delete jobs[t].counts;
+    delete[] workers;
+    delete[] jobs;
+    return ok ? 0 : 1;
+}
+
+// ---------- Win model fitting ----------
+// uno --fit-model <file> [games] [players] [--seed S]
+// Bots play seeded games. Every MODEL_SAMPLE_INTERVAL turns the features of
+// all seats are kept, and once the game is decided each kept position is
+// one Adagrad step on the log-likelihood of the actual winner. The last
+// tenth of the games is held out: it reports the log loss and how often the
+// favourite won, next to the uniform guess.
+const int MODEL_SAMPLE_INTERVAL = 3;
+const int MODEL_MAX_SAMPLES = 128;     // per game; later turns are not sampled
+const double MODEL_LEARNING_RATE = 0.05;
+
+// Plays a bot game and keeps the features of every sampled turn.
+int playModelGame(GameState& g, float samples[], int maxSamples) {
+    const GameEngine& engine = gameEngine(g.rules);
+    int count = 0;
+    while (true) {
+        TurnPhase phase = engine.observe(g);
+        if (phase >= PHASE_WON && g.turns % MODEL_SAMPLE_INTERVAL == 0 && count < maxSamples) {
+            gameModelFeatures(g, samples + count * MAX_PLAYERS * MODEL_FEATURES);
+            count++;
+        }
+        int choice = decideTurn(g, phase);
+        if (engine.resolve(g, phase, choice)) return count;
+    }
+}
+
+int fitModelCommand(int argc, char* argv[]) {
+    const char* path = 0;
+    int games = 200000;
+    int playersCount = 2;
+    unsigned long long seed = 1;
+
+    bool argsOk = true;
+    int positional = 0;
+    for (int i = 2; i < argc; i++) {
+        const char* arg = argv[i];
+        if (strcmp(arg, "--seed") == 0 && i + 1 < argc) seed = strtoull(argv[++i], 0, 10);
+        else if (arg[0] == '-' && arg[1] == '-') argsOk = false;
+        else if (positional == 0) { path = arg; positional++; }
+        else if (positional == 1) { games = atoi(arg); positional++; }
+        else if (positional == 2) { playersCount = atoi(arg); positional++; }
+        else argsOk = false;
+    }
+    if (!argsOk || !path || games < 10 || playersCount < MIN_PLAYERS || playersCount > MAX_PLAYERS) {
+        cout << "Usage: --fit-model <file> [games, at least 10] [players 2-" << MAX_PLAYERS << "] [--seed S]\n";
+        return 1;
+    }
+
+    SimulationConfig config = {};
+    config.playersCount = playersCount;
+    config.deckCount = 1;
+    for (int i = 0; i < MAX_PLAYERS; i++) config.agents[i] = AGENT_BOT;
+
+    WinModel m = {};
+    m.playersCount = playersCount;
+    double squares[MODEL_FEATURES] = {};
+    float* samples = new float[MODEL_MAX_SAMPLES * MAX_PLAYERS * MODEL_FEATURES];
+    int trainGames = games - games / 10;
+    long long trained = 0, tested = 0, favourites = 0;
+    double logLoss = 0;
+
+    ArenaPool pool = {};
+    ostream silent(0);
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int n = 0; n < games; n++) {
+        GameState g = {};
+        setupSilentGame(g, pool, config, config.agents, 0, seed + n, silent, 0, 0);
+        int count = playModelGame(g, samples, MODEL_MAX_SAMPLES);
+        int winner = g.winner;
+        destroyGame(g, pool);
+        if (winner < 0) continue;
+
+        for (int s = 0; s < count; s++) {
+            const float* x = samples + s * MAX_PLAYERS * MODEL_FEATURES;
+            double p[MAX_PLAYERS];
+            modelProbabilities(m, x, playersCount, p);
+
+            if (n >= trainGames) {
+                logLoss -= log(p[winner] > 1e-12 ? p[winner] : 1e-12);
+                int favourite = 0;
+                for (int i = 1; i < playersCount; i++) {
+                    if (p[i] > p[favourite]) favourite = i;
+                }
+                if (favourite == winner) favourites++;
+                tested++;
+                continue;
+            }
+
+            // Gradient of log p[winner]: the winner's features minus their expectation.
+            for (int k = 0; k < MODEL_FEATURES; k++) {
+                double gradient = x[winner * MODEL_FEATURES + k];
+                for (int i = 0; i < playersCount; i++) gradient -= p[i] * x[i * MODEL_FEATURES + k];
+                squares[k] += gradient * gradient;
+                if (squares[k] > 0) m.w[k] += (float)(MODEL_LEARNING_RATE * gradient / sqrt(squares[k]));
+            }
+            trained++;
+        }
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    delete[] samples;
+    destroyArenaPool(pool);
+
+    bool ok = writeWinModel(path, m);
+    cout << "Games: " << games << " at " << playersCount << " players (seed " << seed << "), "
+        << trained << " positions fitted, " << tested << " held out\n";
+    for (int k = 0; k < MODEL_FEATURES; k++) cout << "  " << MODEL_FEATURE_NAMES[k] << " " << m.w[k] << "\n";
+    if (tested > 0) {
+        cout << "Held-out log loss: " << logLoss / tested << " (uniform " << log((double)playersCount) << ")\n";
+        cout << "Favourite won: " << 100.0 * favourites / tested << "% (uniform " << 100.0 / playersCount << "%)\n";
+    }
+    cout << "Time: " << seconds << " s\n";
+    if (!ok) cout << "Cannot write " << path << "\n";
+    return ok ? 0 : 1;
+}
+
+// ---------- Fuzzing ----------
+// Random agents play under the invariant checker, which aborts on the first
+// broken state. fuzzLoadInput and fuzzActionInput take raw bytes and back
+// the libFuzzer targets (-DUNO_FUZZ_LOAD or -DUNO_FUZZ_ACTIONS with
+// -fsanitize=fuzzer); --fuzz soaks random games without libFuzzer.
+const int FUZZ_TURN_LIMIT = 5000;
+const int FUZZ_HEADER_BYTES = 11; // players, decks, rules, 8 seed bytes
+
+void assertGameInvariants(const GameState& g, bool scanCards) {
+    const char* problem = checkGameInvariants(g, scanCards);
+    if (!problem) return;
+    cerr << "Invariant violated: " << problem << " (seed " << g.seed << ", turn " << g.turns << ")\n";
+    abort();
+}
+
+// Read-only stream over a byte buffer, so save files can be fuzzed without
+// touching the disk.
+struct MemoryBuffer : streambuf {
+    MemoryBuffer(const unsigned char* data, size_t size) {
+        char* begin = (char*)data;
+        setg(begin, begin, begin + size);
+    }
+};
+
+void playFuzzGame(GameState& g) {
+    ostream silent(0);
+    g.out = &silent;
+    g.render = false; // the hands' sorted views stay on for the checker
+    g.checkInvariants = true;
+    g.turnLimit = FUZZ_TURN_LIMIT;
+    for (int i = 0; i < g.playersCount; i++) g.players[i].agent = AGENT_RANDOM;
+
+    assertGameInvariants(g, true);
+    runGameLoop(g);
+    assertGameInvariants(g, true);
+}
+
+// A save file. Whatever loadGame accepts must satisfy the invariants and
+// survive a game of random moves.
+int fuzzLoadInput(ArenaPool& pool, const unsigned char* data, size_t size) {
+    MemoryBuffer buffer(data, size);
+    istream in(&buffer);
+
+    GameState g = {};
+    if (loadGameFrom(in, g, pool)) {
+        unsigned long long seed = size;
+        for (size_t i = 0; i < size; i++) seed = seed * 31 + data[i];
+        seedGame(g, seed);
+        playFuzzGame(g);
+    }
+    destroyGame(g, pool);
+    return 0;
+}
+
+// The first bytes pick the table and the seed, the rest steer the random
+// agents' decisions.
+int fuzzActionInput(ArenaPool& pool, const unsigned char* data, size_t size) {
+    unsigned char header[FUZZ_HEADER_BYTES];
+    memset(header, 0, sizeof(header));
+    size_t used = size < sizeof(header) ? size : sizeof(header);
+    memcpy(header, data, used);
+
+    int playersCount = MIN_PLAYERS + header[0] % (MAX_PLAYERS - MIN_PLAYERS + 1);
+    int deckCount = 1 + header[1] % MAX_DECKS;
+    int rules = header[2] % RULE_COMBINATIONS;
+    unsigned long long seed = 0;
+    for (int i = 0; i < 8; i++) seed |= (unsigned long long)header[3 + i] << (8 * i);
+
+    GameState g = {};
+    createGame(g, pool, playersCount, deckCount, rules);
+    seedGame(g, seed);
+    g.decisionBytes = data + used;
+    g.decisionBytesLeft = (int)(size - used);
+
+    newShuffledDeck(g);
+    dealInitialCards(g);
+    startTopCard(g);
+    playFuzzGame(g);
+
+    destroyGame(g, pool);
+    return 0;
+}
+
+#if defined(UNO_FUZZ_LOAD) || defined(UNO_FUZZ_ACTIONS)
+extern "C" int LLVMFuzzerTestOneInput(const unsigned char* data, size_t size) {
+    static ArenaPool pool = {};
+#ifdef UNO_FUZZ_LOAD
+    return fuzzLoadInput(pool, data, size);
+#else
+    return fuzzActionInput(pool, data, size);
+#endif
+}
+#endif
+
+// uno --fuzz [games] [--seed S]
+// Random tables, seeds and decisions; every game is checked at every turn.
+int fuzzCommand(int argc, char* argv[]) {
+    int games = 100000;
+    unsigned long long seed = (unsigned long long)time(0);
+
+    bool argsOk = true;
+    int positional = 0;
+    for (int i = 2; i < argc; i++) {
+        const char* arg = argv[i];
+        if (strcmp(arg, "--seed") == 0 && i + 1 < argc) seed = strtoull(argv[++i], 0, 10);
+        else if (arg[0] == '-' && arg[1] == '-') argsOk = false;
+        else if (positional == 0) { games = atoi(arg); positional++; }
+        else argsOk = false;
+    }
+    if (!argsOk || games <= 0) {
+        cout << "Usage: --fuzz [games] [--seed S]\n";
+        return 1;
+    }
+
+    ArenaPool pool = {};
+    unsigned long long rng = seed;
+    long long turns = 0;
+    int finished = 0;
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int n = 0; n < games; n++) {
+        unsigned char header[FUZZ_HEADER_BYTES];
+        unsigned long long bits = splitMix64(rng);
+        for (int i = 0; i < 3; i++) header[i] = (unsigned char)(bits >> (8 * i));
+        unsigned long long gameSeed = seed + n;
+        for (int i = 0; i < 8; i++) header[3 + i] = (unsigned char)(gameSeed >> (8 * i));
+
+        GameState g = {};
+        int playersCount = MIN_PLAYERS + header[0] % (MAX_PLAYERS - MIN_PLAYERS + 1);
+        createGame(g, pool, playersCount, 1 + header[1] % MAX_DECKS, header[2] % RULE_COMBINATIONS);
+        seedGame(g, gameSeed);
+        newShuffledDeck(g);
+        dealInitialCards(g);
+        startTopCard(g);
+        playFuzzGame(g);
+
+        turns += g.turns;
+        if (g.winner >= 0) finished++;
+        destroyGame(g, pool);
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    destroyArenaPool(pool);
+
+    cout << "Games: " << games << " (" << finished << " won, seed " << seed << "), all invariants held\n";
+    cout << "Turns checked: " << turns << "\n";
+    cout << "Time: " << seconds << " s";
+    if (seconds > 0) cout << " (" << (long long)(turns / seconds) << " turns/s)";
+    cout << "\n";
+    return 0;
+}
+
+// ---------- Analysis ----------
+// uno --analyze [file]: solves the saved position if it is a small endgame.
+int analyzeCommand(int argc, char* argv[]) {
+    const char* filename = argc > 2 ? argv[2] : "save.txt";
+
+    ArenaPool pool = {};
+    GameState g = {};
+    if (!loadGame(filename, g, pool)) {
+        cout << "Cannot load " << filename << "\n";
+        destroyGame(g, pool);
+        destroyArenaPool(pool);
+        return 1;
+    }
+
+    cout << "Player " << (g.currentPlayer + 1) << " to move, current card ";
+    printCard(cout, g.topCard);
+    cout << " (" << colorToChar(g.activeColor) << ")\n";
+
+    int status = 0;
+    if (!isSolvableEndgame(g)) {
+        cout << "Not a solvable endgame (2 players, standard rules, a hand of at most "
+            << SOLVER_SHORT_HAND << " cards and none over " << SOLVER_MAX_HAND << ").\n";
+        status = 1;
+    }
+    else {
+        EndgameSolver* solver = createEndgameSolver();
+        EndgameResult r;
+
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        bool complete = solveEndgame(g, *solver, r);
+        long long micros = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+
+        if (!complete) cout << "Node budget exhausted.\n";
+        else if (r.score == SOLVER_WIN) cout << "Win for player " << (g.currentPlayer + 1) << "\n";
+        else if (r.score == -SOLVER_WIN) cout << "Loss for player " << (g.currentPlayer + 1) << "\n";
+        else cout << "Unresolved: the result depends on a reshuffle.\n";
+
+        if (complete) {
+            cout << "Best move: ";
+            printSolverMove(cout, g, r.best);
+            cout << "\n";
+        }
+        cout << "Nodes: " << r.nodes << ", time: " << micros << " us\n";
+        destroyEndgameSolver(solver);
+    }
+
+    destroyGame(g, pool);
+    destroyArenaPool(pool);
+    return status;
+}
+
+// ---------- Menu helpers ----------
+int readMenuChoice() {
+    cout << "--- UNO ---\n";
+    cout << "[1] New Game\n";
+    cout << "[2] Continue Game\n";
+    cout << "[3] Exit\n";
+    cout << "Choose: ";
+    int c;
+    cin >> c;
+    return c;
+}
+
+int readPlayersCount() {
+    int playersCount;
+    while (true) {
+        cout << "Enter number of players (" << MIN_PLAYERS << "-" << MAX_PLAYERS << "): ";
+        cin >> playersCount;
+        if (playersCount >= MIN_PLAYERS && playersCount <= MAX_PLAYERS) return playersCount;
+        cout << "Invalid number of players.\n";
+    }
+}
+
+// Large parties need more cards: 7 per player plus a usable draw pile.
+int readDeckCount(int playersCount) {
+    if (playersCount <= 4) return 1;
+    int deckCount;
+    while (true) {
+        cout << "Enter number of combined decks (1-" << MAX_DECKS << "): ";
+        cin >> deckCount;
+        if (deckCount >= 1 && deckCount <= MAX_DECKS) return deckCount;
+        cout << "Invalid number of decks.\n";
+    }
+}
+
+int readHouseRules() {
+    if (!askYesNo("Play with house rules?")) return RULES_STANDARD;
+
+    int rules = RULES_STANDARD;
+    if (askYesNo("Stacking +2/+4?")) rules |= RULE_STACKING;
+    if (askYesNo("Draw until playable?")) rules |= RULE_DRAW_UNTIL_PLAYABLE;
+    if (askYesNo("7 swaps hands, 0 rotates hands?")) rules |= RULE_SEVEN_ZERO;
+    if (askYesNo("Jump-in with identical cards?")) rules |= RULE_JUMP_IN;
+    if (askYesNo("Challenge Wild+4?")) rules |= RULE_CHALLENGE_PLUS4;
+    return rules;
+}
+
+// ---------- main ----------
+// libFuzzer builds bring their own main.
+#if !defined(UNO_FUZZ_LOAD) && !defined(UNO_FUZZ_ACTIONS)
+int main(int argc, char* argv[]) {
+    if (argc > 1 && strcmp(argv[1], "--simulate") == 0) return simulateCommand(argc, argv);
+    if (argc > 1 && strcmp(argv[1], "--evaluate") == 0) return evaluateCommand(argc, argv);
+    if (argc > 1 && strcmp(argv[1], "--tune") == 0) return tuneCommand(argc, argv);
+    if (argc > 1 && strcmp(argv[1], "--fuzz") == 0) return fuzzCommand(argc, argv);
+    if (argc > 1 && strcmp(argv[1], "--analyze") == 0) return analyzeCommand(argc, argv);
+    if (argc > 1 && strcmp(argv[1], "--spectate") == 0) return spectateCommand(argc, argv);
+    if (argc > 1 && strcmp(argv[1], "--host") == 0) return hostCommand(argc, argv);
+    if (argc > 1 && strcmp(argv[1], "--build-book") == 0) return buildBookCommand(argc, argv);
+    if (argc > 1 && strcmp(argv[1], "--fit-model") == 0) return fitModelCommand(argc, argv);
+    if (argc > 1 && strcmp(argv[1], "--coordinate") == 0) return coordinateCommand(argc, argv);
+    if (argc > 1 && strcmp(argv[1], "--work") == 0) return workCommand(argc, argv);
+
+    // uno [--autosave N] [--metrics FILE] [--seed S]: save every N turns in
+    // the background to AUTOSAVE_FILE (0 = never); export latency metrics to FILE; deal a new
+    // game from seed S instead of the clock. Loaded games keep the seed and
+    // generator state of their save.
+    int autosaveTurns = AUTOSAVE_INTERVAL;
+    const char* metricsPath = 0;
+    unsigned long long seed = (unsigned long long)time(0);
+    bool argsOk = true;
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        if (strcmp(arg, "--autosave") == 0 && i + 1 < argc) autosaveTurns = atoi(argv[++i]);
+        else if (strcmp(arg, "--metrics") == 0 && i + 1 < argc) metricsPath = argv[++i];
+        else if (strcmp(arg, "--seed") == 0 && i + 1 < argc) seed = strtoull(argv[++i], 0, 10);
+        else argsOk = false;
+    }
+    if (!argsOk || autosaveTurns < 0) {
+        cout << "Usage: uno [--autosave N] [--metrics FILE] [--seed S]\n"
+             << "Other modes: --simulate, --coordinate, --work, --evaluate, --tune, --build-book,\n"
+             << "--fit-model, --fuzz, --spectate, --host, --analyze\n";
+        return 1;
+    }
+
+    ArenaPool pool = {};
+    GameState g = {};
+
+    int menu = readMenuChoice();
+    if (menu == 3) return 0;
+
+    Metrics* metrics = metricsPath ? createMetrics(metricsPath) : 0;
+    if (menu == 2) {
+        const char* path = "save.txt";
+        ifstream autosaved(AUTOSAVE_FILE);
+        if (autosaved.is_open()) {
+            autosaved.close();
+            if (askYesNo("An unfinished game was autosaved. Resume it instead of save.txt?")) path = AUTOSAVE_FILE;
+        }
+        long long start = metricsClock();
+        bool ok = loadGame(path, g, pool);
+        if (metrics) recordLatency(*metrics, LATENCY_LOAD, metricsClock() - start);
+        if (!ok) {
+            cout << "No saved game found or save file is corrupted.\n";
+            destroyGame(g, pool);
+            destroyArenaPool(pool);
+            if (metrics) destroyMetrics(metrics);
+            return 0;
+        }
+        cout << "Game loaded from " << path << " (seed " << g.seed << ")\n";
+    }
+    else {
+        int playersCount = readPlayersCount();
+        int deckCount = readDeckCount(playersCount);
+        int rules = readHouseRules();
+
+        createGame(g, pool, playersCount, deckCount, rules);
+        seedGame(g, seed);
+        newShuffledDeck(g);
+
+        dealInitialCards(g);
+        startTopCard(g);
+
+        g.currentPlayer = 0;
+        g.direction = 1;
+    }
+
+    g.metrics = metrics;
+    if (autosaveTurns > 0) g.autosave = createAutosave(g, pool, AUTOSAVE_FILE, autosaveTurns);
+    runGameLoop(g);
+    if (g.autosave) {
+        stopAutosave(*g.autosave, true);
+        int failures = g.autosave->failures;
+        destroyAutosave(g.autosave, pool);
+        if (failures > 0) cout << "Autosave failed " << failures << " time(s).\n";
+        if (g.winner >= 0) remove(AUTOSAVE_FILE);
+    }
+    destroyGame(g, pool);
+    destroyArenaPool(pool);
+    if (metrics) destroyMetrics(metrics);
+
+    cout << "Exiting...\n";
+    return 0;
+}
+#endif
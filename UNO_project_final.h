@@ -0,0 +1,361 @@
+/**
+*
+* Solution to course project # 4
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2025/2026
+*
+* @author Rangel Parishev
+* @idnumber 0MI0600668
+* @compiler GCC or Clang (-std=c++17 -pthread), VS (C++17)
+*
+* <declarations of UNO_project_final.cpp shared with the other files>
+*
+*/
+// The game's types, and the functions of UNO_project_final.cpp that the
+// commands in the other files (UNO_host.cpp, UNO_distributed.cpp,
+// UNO_spectator.cpp) build on.
+#ifndef UNO_PROJECT_FINAL_H
+#define UNO_PROJECT_FINAL_H
+
+#include <iostream>
+
+// ---------- Constants ----------
+const int CARDS_PER_DECK = 108;
+const int MAX_DECKS = 3;
+const int MAX_PLAYERS = 10;
+const int MIN_PLAYERS = 2;
+// Bump whenever a change alters how seeded games play out: it keys the
+// simulation result cache (--simulate --cache).
+const int ENGINE_VERSION = 2;
+
+// ---------- Enums and Structures ----------
+// One byte each, so a card is two bytes and hands stay small in big games.
+enum Color : unsigned char { RED, GREEN, BLUE, YELLOW, WILD };
+
+enum Value : unsigned char {
+    ZERO, ONE, TWO, THREE, FOUR, FIVE, SIX, SEVEN, EIGHT, NINE,
+    SKIP, REVERSE, PLUS2, WILD_CARD, WILD_PLUS4
+};
+
+struct Card {
+    Color color;
+    Value value;
+};
+
+// AGENT_ENDGAME plays like AGENT_BOT but solves small endgames exactly. It
+// sees every card, so it is a perfect-information reference, not a fair bot.
+// AGENT_RANDOM makes random (occasionally illegal) choices for the fuzzer.
+// AGENT_REMOTE plays the moves a hosted game receives (see Remote tables).
+// AGENT_BOOK plays like AGENT_BOT but takes its first plays from an opening book.
+enum AgentKind : unsigned char { AGENT_HUMAN, AGENT_BOT, AGENT_ENDGAME, AGENT_RANDOM, AGENT_REMOTE, AGENT_BOOK };
+
+// Heuristic weights of the bots (see botCardChoice and botColorChoice). The
+// defaults play the highest card and keep wilds for last; --tune searches
+// for better ones.
+enum BotWeight {
+    W_FACE_VALUE,      // per point of card value
+    W_WILD,            // playing a wild instead of holding it
+    W_ACTION,          // Skip, Reverse and +2
+    W_COLOR_KEPT,      // per other card of the color left active
+    W_THREAT,          // action or draw card while the next player has two cards or fewer
+    W_COLOR_ACTIONS,   // per action card of a color when naming a color
+    BOT_WEIGHT_COUNT
+};
+
+struct BotWeights {
+    double w[BOT_WEIGHT_COUNT];
+};
+
+const BotWeights DEFAULT_BOT_WEIGHTS = { { 1, -100, 0, 0, 0, 0 } };
+const char* const BOT_WEIGHT_NAMES[BOT_WEIGHT_COUNT] = {
+    "face_value", "wild", "action", "color_kept", "threat", "color_actions"
+};
+
+// Hands point into the game's arena (see createGame).
+struct Player {
+    Card* hand;
+    int cardCount;
+    short* order;      // display position -> hand slot, by color then value; null in silent games
+    short* position;   // hand slot -> display position
+    int groupEnd[5];   // per color: display position after its last card
+    AgentKind agent;
+    const BotWeights* weights; // bots only
+};
+
+struct CardEffect {
+    int drawCount;     // 0, 2, 4
+    bool skipNext;     // Skip, +2, +4, Reverse (when 2 players)
+    bool reverseDir;   // Reverse (when 3-4 players)
+    bool chooseColor;  // Wild / Wild+4
+    bool swapHands;    // 7 (7-0 rule)
+    bool rotateHands;  // 0 (7-0 rule)
+};
+
+// ---------- House rules ----------
+// A rule set is a bitmask of RuleFlag values. The game loop is a template
+// over the mask, so every rule set gets its own compiled engine and rules
+// that are switched off cost no branches in the turn loop.
+enum RuleFlag {
+    RULE_STACKING = 1,            // +2 on +2, +4 on anything pending
+    RULE_DRAW_UNTIL_PLAYABLE = 2, // keep drawing until a card can be played
+    RULE_SEVEN_ZERO = 4,          // 7 swaps hands, 0 rotates all hands
+    RULE_JUMP_IN = 8,             // identical card may be played out of turn
+    RULE_CHALLENGE_PLUS4 = 16     // Wild+4 may be challenged
+};
+
+const int RULES_STANDARD = 0;
+const int RULE_COMBINATIONS = 32;
+
+// ---------- Arena ----------
+// Bump allocator for data that lives exactly as long as one game. Nothing is
+// freed on its own; the whole arena goes back to its pool when the game ends.
+struct Arena {
+    char* base;
+    int capacity;
+    int used;
+    Arena* next;   // free list link while the arena sits in a pool
+};
+
+// Recycles arenas across games, so after the first game of a given size
+// no further allocations are made.
+struct ArenaPool {
+    Arena* freeList;
+    int arenasCreated;
+};
+
+const int MOVE_LOG_CAPACITY = 1024;
+
+// One played card. The log is a ring: long games keep the latest moves.
+struct MoveRecord {
+    unsigned char player;
+    Card card;
+    Color chosenColor;
+};
+
+// A remote seat's answer to one step, with everything the step may ask on
+// the way: the color of a wild, the target of a 7 and the UNO call.
+struct RemoteMove {
+    int choice;      // hand slot, 1/0 for the drawn card, or -2 to take a pending draw
+    int color;       // for a wild, else -1
+    int swapTarget;  // for a 7 under the 7-0 rule, else -1
+    bool uno;
+};
+
+struct EndgameSolver;
+struct OpeningBook;
+struct ColumnBuffer;
+struct ColumnTable;
+struct Autosave;
+struct Metrics;
+struct SpectatorFeed;
+
+// Where a game stands between two steps of the turn pipeline.
+enum TurnStage : unsigned char {
+    STAGE_JUMP_IN, // a new turn; others may jump in first
+    STAGE_BEGIN,   // nobody jumped in, the current player's turn begins
+    STAGE_TURN,    // the turn is counted, the current player moves (again after an invalid move)
+    STAGE_DRAWN    // the current player may play the card just drawn
+};
+
+// Everything a game owns is carved out of one arena sized from the player
+// count and the number of combined decks.
+struct GameState {
+    Arena* arena;
+    int deckCount;
+    int totalCards;
+
+    Player* players;
+    int playersCount;
+
+    // Draw pile and discard pile share one ring of totalCards slots. The draw
+    // pile runs from pileStart (its top) for deckSize cards and the discard
+    // pile follows it, oldest card first.
+    Card* piles;
+    int pileStart;
+    int deckSize;
+    int discardSize;
+    int missingCards;  // cards an old save lost (see loadGameFrom)
+
+    Card topCard;
+    Color activeColor;
+
+    int currentPlayer;
+    int direction;
+
+    int rules;
+    int pendingDraw;   // stacked +2/+4 cards waiting for the current player
+    TurnStage turnStage;
+
+    MoveRecord* moveLog;
+    int moveCount;
+
+    int* agentScratch; // per-decision workspace for bots, totalCards ints
+    short* handViews;  // room for every player's sorted view, see setRender
+    EndgameSolver* solver; // shared by AGENT_ENDGAME players, may be null
+    const OpeningBook* book; // shared by AGENT_BOOK players, may be null
+    int plannedColor;  // color a bot decided on together with its card, or -1
+    RemoteMove remoteMove; // what a remote seat sent for the step being resolved
+
+    std::ostream* out; // table output; a silent stream for simulations
+    bool render;       // show the table every turn; off when nobody watches
+    int winner;        // -1 while the game is running or when it was abandoned
+
+    unsigned long long seed; // seed the game was started from
+    unsigned long long rng;  // shuffle generator state
+
+    // Statistics
+    int turns;
+    int refills;
+    int cardsDrawn;
+    int actionCardsPlayed;
+    int unoPenalties;      // missed UNO declarations
+    ColumnBuffer* turnLog; // per-turn export rows, may be null
+    Autosave* autosave;    // background saves every few turns, may be null
+    SpectatorFeed* spectators; // public views for other threads, may be null
+    Metrics* metrics;      // latency histograms and counters, may be null
+
+    // Fuzzing
+    bool checkInvariants;  // verify the state at every turn, abort on failure
+    int turnLimit;         // 0 = play until the game ends
+    const unsigned char* decisionBytes; // steer AGENT_RANDOM while they last
+    int decisionBytesLeft;
+};
+
+// ---------- Win model ----------
+enum ModelFeature {
+    F_CARDS,           // hand size / 10
+    F_ONE_CARD,        // one card left
+    F_TWO_CARDS,       // two cards left
+    F_WILDS,           // Wild cards held
+    F_PLUS4S,          // Wild+4 cards held
+    F_ACTIONS,         // Skip, Reverse and +2 held
+    F_ACTIVE_COLOR,    // cards of the active color / 10
+    F_LARGEST_COLOR,   // cards of the seat's largest color / 10
+    F_COLORS,          // colors held / 4
+    F_TO_MOVE,         // the seat moves next
+    F_SEATS_AWAY,      // turns until the seat moves / players
+    F_CARDS_BY_PILE,   // hand size / 10 * draw pile / total cards
+    MODEL_FEATURES
+};
+
+struct WinModel {
+    int playersCount;          // table size it was fitted on
+    float w[MODEL_FEATURES];
+};
+
+// ---------- Turn pipeline ----------
+// Phases from PHASE_WON on are rendered. The first step of a turn counts it
+// in g.turns and logs it; a retry after an invalid move does neither. A
+// jump-in play is counted and logged when it resolves.
+enum TurnPhase : unsigned char {
+    PHASE_OVER,         // out of turns
+    PHASE_JUMP_IN,      // another player holds a copy of the top card
+    PHASE_PLAY_DRAWN,   // the card just drawn can be played
+    PHASE_WON,          // the current player has no cards left
+    PHASE_PENDING_DRAW, // stack a draw card or take the pending draw
+    PHASE_DRAW,         // no valid move
+    PHASE_PLAY          // pick a card from the hand
+};
+
+// One specialized engine per rule set (see gameEngine).
+typedef void (*GameLoopFn)(GameState&);
+typedef TurnPhase (*ObserveTurnFn)(GameState&);
+typedef bool (*ResolveTurnFn)(GameState&, TurnPhase, int);
+
+struct GameEngine {
+    GameLoopFn run;
+    ObserveTurnFn observe;
+    ResolveTurnFn resolve;
+};
+
+// ---------- Simulation ----------
+const int MAX_SIMULATION_THREADS = 64;
+const int LOCKSTEP_BATCH = 256; // default games in flight per thread for --lockstep
+
+struct SimulationConfig {
+    int playersCount;
+    int deckCount;
+    int rules;
+    AgentKind agents[MAX_PLAYERS];
+    unsigned long long firstSeed;
+    int batchSize;            // games stepped together, 1..GAME_BATCH_SIZE
+    bool lockstep;            // play on the lockstep engine (see canPlayLockstep)
+    const OpeningBook* book;  // for AGENT_BOOK seats, may be null
+    const WinModel* model;    // for the endgame solver of AGENT_ENDGAME seats, may be null
+    ColumnTable* gameTable;   // may be null
+    ColumnTable* turnTable;   // may be null
+};
+
+struct SimulationStats {
+    int games;
+    int unfinished;
+    long long turns;
+    int wins[MAX_PLAYERS];
+    int arenasCreated;
+};
+
+// ---------- Functions ----------
+// Shared by the command modules (UNO_spectator, UNO_host, UNO_distributed);
+// everything else stays local to UNO_project_final.cpp.
+
+// Arena
+void destroyArenaPool(ArenaPool& pool);
+
+// Utilities
+char colorToChar(Color c);
+void printCard(std::ostream& out, const Card& c);
+bool isValidMove(const Card& played, const Card& topCard, Color activeColor);
+
+// Discard / Refill / Draw
+void newShuffledDeck(GameState& g);
+
+// Effects
+bool isStackable(const Card& c, const Card& topCard);
+bool hasStackableCard(const Player& p, const Card& topCard);
+
+// Game setup
+void setRender(GameState& g, bool render);
+bool createGame(GameState& g, ArenaPool& pool, int playersCount, int deckCount, int rules);
+void seedGame(GameState& g, unsigned long long seed);
+void destroyGame(GameState& g, ArenaPool& pool);
+void dealInitialCards(GameState& g);
+void startTopCard(GameState& g);
+
+// Invariants
+const char* checkGameInvariants(const GameState& g, bool scanCards);
+
+// Endgame solver
+bool readSolverModel(const char* path, WinModel& m);
+
+// Opening book
+void closeOpeningBook(OpeningBook* book);
+OpeningBook* openOpeningBook(const char* path);
+
+// Agents
+bool isRemote(const GameState& g, int player);
+
+// Turn pipeline
+int decideTurn(GameState& g, TurnPhase phase);
+
+// Engine dispatch
+const GameEngine& gameEngine(int rules);
+void runGameLoop(GameState& g);
+
+// Simulation
+void clearStats(SimulationStats& stats);
+void addStats(SimulationStats& total, const SimulationStats& s);
+void setupSilentGame(GameState& g, ArenaPool& pool, const SimulationConfig& config,
+    const AgentKind agents[], const BotWeights* const weights[], unsigned long long seed, std::ostream& silent,
+    EndgameSolver* solver, ColumnBuffer* turnLog);
+void runSimulation(const SimulationConfig& config, int games, int threads, SimulationStats& stats);
+void printSimulationTotals(const SimulationStats& stats, unsigned long long seed, int playersCount);
+bool parseAgents(const char* text, int playersCount, AgentKind agents[]);
+
+// Result cache
+unsigned long long simulationKey(const SimulationConfig& config);
+
+// Lockstep engine
+bool canPlayLockstep(const SimulationConfig& config);
+
+#endif
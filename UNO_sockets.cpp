@@ -0,0 +1,122 @@
+/**
+*
+* Solution to course project # 4
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2025/2026
+*
+* @author Rangel Parishev
+* @idnumber 0MI0600668
+* @compiler GCC or Clang (-std=c++17 -pthread), VS (C++17)
+*
+* <TCP lines for the distributed simulation>
+*
+*/
+// ---------- Libraries ----------
+#include <cstring>
+#include <cstdlib>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#include "UNO_sockets.h"
+
+// ---------- Sockets ----------
+bool startSockets() {
+#ifdef _WIN32
+    WSADATA data;
+    return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+#else
+    return true;
+#endif
+}
+
+void closeSocket(Socket s) {
+#ifdef _WIN32
+    closesocket(s);
+#else
+    close(s);
+#endif
+}
+
+int pollSockets(SocketPoll polls[], int count, int timeoutMs) {
+#ifdef _WIN32
+    return WSAPoll(polls, (ULONG)count, timeoutMs);
+#else
+    return poll(polls, (nfds_t)count, timeoutMs);
+#endif
+}
+
+bool parseEndpoint(const char* text, sockaddr_in& addr) {
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    const char* colon = strrchr(text, ':');
+    const char* portText = colon ? colon + 1 : text;
+    if (colon) {
+        char host[64];
+        if (colon - text >= (int)sizeof(host)) return false;
+        memcpy(host, text, colon - text);
+        host[colon - text] = '\0';
+        if (inet_pton(AF_INET, host, &addr.sin_addr) != 1) return false;
+    }
+    char* end;
+    long port = strtol(portText, &end, 10);
+    if (*end || port <= 0 || port > 65535) return false;
+    addr.sin_port = htons((unsigned short)port);
+    return true;
+}
+
+Socket listenOn(const sockaddr_in& addr) {
+    Socket s = socket(AF_INET, SOCK_STREAM, 0);
+    if (s == NO_SOCKET) return NO_SOCKET;
+    int on = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char*)&on, sizeof(on));
+    if (bind(s, (const sockaddr*)&addr, sizeof(addr)) != 0 || listen(s, 64) != 0) {
+        closeSocket(s);
+        return NO_SOCKET;
+    }
+    return s;
+}
+
+Socket connectTo(const sockaddr_in& addr) {
+    Socket s = socket(AF_INET, SOCK_STREAM, 0);
+    if (s == NO_SOCKET) return NO_SOCKET;
+    if (connect(s, (const sockaddr*)&addr, sizeof(addr)) != 0) {
+        closeSocket(s);
+        return NO_SOCKET;
+    }
+    return s;
+}
+
+bool sendLine(Socket s, const char* line) {
+    int length = (int)strlen(line);
+    for (int sent = 0; sent < length;) {
+        int n = (int)send(s, line + sent, length - sent, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        sent += n;
+    }
+    return true;
+}
+
+bool receiveLines(Socket s, LineReader& r) {
+    if (r.length == SOCKET_LINE_LENGTH) return false;
+    int n = (int)recv(s, r.data + r.length, SOCKET_LINE_LENGTH - r.length, 0);
+    if (n <= 0) return false;
+    r.length += n;
+    return true;
+}
+
+bool nextLine(LineReader& r, char line[SOCKET_LINE_LENGTH]) {
+    char* end = (char*)memchr(r.data, '\n', r.length);
+    if (!end) return false;
+    int length = (int)(end - r.data);
+    memcpy(line, r.data, length);
+    line[length] = '\0';
+    if (length > 0 && line[length - 1] == '\r') line[length - 1] = '\0';
+    r.length -= length + 1;
+    memmove(r.data, end + 1, r.length);
+    return true;
+}
+
@@ -0,0 +1,70 @@
+/**
+*
+* Solution to course project # 4
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2025/2026
+*
+* @author Rangel Parishev
+* @idnumber 0MI0600668
+* @compiler GCC or Clang (-std=c++17 -pthread), VS (C++17)
+*
+* <TCP lines for the distributed simulation>
+*
+*/
+#ifndef UNO_SOCKETS_H
+#define UNO_SOCKETS_H
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#endif
+
+// ---------- Sockets ----------
+// Plain TCP lines for the distributed simulation. Blocking sockets; the
+// coordinator waits on all of its workers at once with poll.
+#ifdef _WIN32
+typedef SOCKET Socket;
+const Socket NO_SOCKET = INVALID_SOCKET;
+typedef WSAPOLLFD SocketPoll;
+#else
+typedef int Socket;
+const Socket NO_SOCKET = -1;
+typedef pollfd SocketPoll;
+#endif
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0 // where it exists, sending to a lost peer fails instead of raising SIGPIPE
+#endif
+const int SOCKET_LINE_LENGTH = 512;
+
+struct LineReader {
+    char data[SOCKET_LINE_LENGTH];
+    int length;
+};
+
+bool startSockets();
+void closeSocket(Socket s);
+int pollSockets(SocketPoll polls[], int count, int timeoutMs);
+
+// "[address:]port"; the address is IPv4 and defaults to the loopback.
+bool parseEndpoint(const char* text, sockaddr_in& addr);
+
+Socket listenOn(const sockaddr_in& addr);
+Socket connectTo(const sockaddr_in& addr);
+bool sendLine(Socket s, const char* line);
+
+// One recv into the reader. False when the peer is gone or a line does not
+// fit the buffer.
+bool receiveLines(Socket s, LineReader& r);
+
+// Takes the next complete line out of the reader, without its newline.
+bool nextLine(LineReader& r, char line[SOCKET_LINE_LENGTH]);
+
+#endif
@@ -0,0 +1,277 @@
+/**
+*
+* Solution to course project # 4
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2025/2026
+*
+* @author Rangel Parishev
+* @idnumber 0MI0600668
+* @compiler GCC or Clang (-std=c++17 -pthread), VS (C++17)
+*
+* <spectator feed>
+*
+*/
+// ---------- Libraries ----------
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <ctime>
+#include <chrono>
+#include <thread>
+#include <atomic>
+
+#include "UNO_spectator.h"
+
+using namespace std;
+
+// ---------- Spectator feed ----------
+// Spectators watch a game from other threads. At the start of every turn the
+// game thread publishes a SpectatorView of the public table into a free slot
+// and swaps it in as the feed's latest view; spectators take a reference to
+// whichever view is latest and read it in place, so a view is never copied
+// per spectator and is never changed once published. Neither side locks.
+//
+// The latest pointer is a slot index packed with an external reference
+// count, so a spectator finds the view and counts itself on it in one
+// fetch_add; the slot cannot be retired in between. When a view is swapped
+// out its external count moves to the slot's own count, and whoever brings
+// that to zero (the publisher or the last spectator) frees the slot. A slot
+// is only reused once it is free, so the game thread never waits: if every
+// slot is still held, that turn is simply not published.
+const int SPECTATOR_SLOTS = 64;
+const unsigned long long SPECTATOR_NO_VIEW = 0xFFFF;     // index while nothing is published
+const unsigned long long SPECTATOR_REF = 1ULL << 16;     // one external reference
+
+struct SpectatorView {
+    unsigned long long sequence; // publications so far, 1 for the first view
+    int turns;
+    Card topCard;
+    Color activeColor;
+    int direction;
+    int currentPlayer;
+    int pendingDraw;
+    int winner;
+    int playersCount;
+    int cardCounts[MAX_PLAYERS];
+    int deckSize;
+    int discardSize;
+    int missingCards;
+    int totalCards;
+};
+
+struct SpectatorSlot {
+    SpectatorView view; // first, so a view's address is its slot's
+    atomic<int> refs;   // references handed over minus references released
+    atomic<bool> inUse;
+};
+
+struct SpectatorFeed {
+    SpectatorSlot slots[SPECTATOR_SLOTS];
+    atomic<unsigned long long> latest; // count << 16 | slot index
+    unsigned long long published;      // game thread only
+    int nextSlot;                      // game thread only
+    atomic<long long> skipped;         // turns not published, every slot held
+};
+
+SpectatorFeed* createSpectatorFeed() {
+    SpectatorFeed* f = new SpectatorFeed();
+    for (int i = 0; i < SPECTATOR_SLOTS; i++) {
+        f->slots[i].refs.store(0);
+        f->slots[i].inUse.store(false);
+    }
+    f->latest.store(SPECTATOR_NO_VIEW);
+    f->published = 0;
+    f->nextSlot = 0;
+    f->skipped.store(0);
+    return f;
+}
+
+void freeSpectatorSlot(SpectatorSlot& s) {
+    s.inUse.store(false, memory_order_release);
+}
+
+// Drops the feed's own reference to a view that is no longer latest and
+// hands over the references spectators took through the latest pointer.
+void retireSpectatorView(SpectatorFeed& f, unsigned long long word) {
+    int index = (int)(word & SPECTATOR_NO_VIEW);
+    if (index == (int)SPECTATOR_NO_VIEW) return;
+    int transferred = (int)(word >> 16) - 1;
+    SpectatorSlot& s = f.slots[index];
+    if (s.refs.fetch_add(transferred, memory_order_acq_rel) == -transferred) freeSpectatorSlot(s);
+}
+
+void publishSpectatorView(SpectatorFeed& f, const GameState& g) {
+    int index = -1;
+    for (int n = 0; n < SPECTATOR_SLOTS && index < 0; n++) {
+        int i = (f.nextSlot + n) % SPECTATOR_SLOTS;
+        if (!f.slots[i].inUse.load(memory_order_acquire)) index = i;
+    }
+    if (index < 0) {
+        f.skipped.fetch_add(1, memory_order_relaxed);
+        return;
+    }
+    f.nextSlot = (index + 1) % SPECTATOR_SLOTS;
+
+    SpectatorSlot& s = f.slots[index];
+    s.inUse.store(true, memory_order_relaxed);
+    s.refs.store(0, memory_order_relaxed);
+
+    SpectatorView& v = s.view;
+    v.sequence = ++f.published;
+    v.turns = g.turns;
+    v.topCard = g.topCard;
+    v.activeColor = g.activeColor;
+    v.direction = g.direction;
+    v.currentPlayer = g.currentPlayer;
+    v.pendingDraw = g.pendingDraw;
+    v.winner = g.winner;
+    v.playersCount = g.playersCount;
+    for (int i = 0; i < g.playersCount; i++) v.cardCounts[i] = g.players[i].cardCount;
+    v.deckSize = g.deckSize;
+    v.discardSize = g.discardSize;
+    v.missingCards = g.missingCards;
+    v.totalCards = g.totalCards;
+
+    // The release publishes the view along with its slot index.
+    unsigned long long old = f.latest.exchange(SPECTATOR_REF | (unsigned long long)index, memory_order_acq_rel);
+    retireSpectatorView(f, old);
+}
+
+// Spectator side. Returns the latest view, or 0 before the first one; a
+// view must be handed back with releaseSpectatorView.
+const SpectatorView* acquireSpectatorView(SpectatorFeed& f) {
+    unsigned long long word = f.latest.fetch_add(SPECTATOR_REF, memory_order_acquire);
+    int index = (int)(word & SPECTATOR_NO_VIEW);
+    if (index == (int)SPECTATOR_NO_VIEW) return 0;
+    return &f.slots[index].view;
+}
+
+void releaseSpectatorView(SpectatorFeed&, const SpectatorView* v) {
+    SpectatorSlot& s = *(SpectatorSlot*)v;
+    if (s.refs.fetch_sub(1, memory_order_acq_rel) == 1) freeSpectatorSlot(s);
+}
+
+void destroySpectatorFeed(SpectatorFeed* f) {
+    delete f;
+}
+
+// ---------- Spectating ----------
+// Plays seeded bot games on the main thread while spectator threads follow
+// the feed and check every view they pick up, then plays the same games
+// without a feed to compare the turn rate.
+const int MAX_SPECTATORS = 64;
+
+struct SpectatorStats {
+    long long reads;     // views acquired
+    long long views;     // distinct views seen
+    long long broken;    // views out of order or not adding up
+};
+
+// A published view must account for every card, like the game it came from.
+bool isConsistentView(const SpectatorView& v) {
+    if (v.currentPlayer < 0 || v.currentPlayer >= v.playersCount) return false;
+    if (v.direction != 1 && v.direction != -1) return false;
+    if (v.activeColor >= WILD) return false;
+    int cards = 1 + v.deckSize + v.discardSize + v.missingCards;
+    for (int i = 0; i < v.playersCount; i++) cards += v.cardCounts[i];
+    return cards == v.totalCards;
+}
+
+void runSpectator(SpectatorFeed* f, atomic<bool>* stopping, SpectatorStats* stats) {
+    unsigned long long lastSequence = 0;
+    while (!stopping->load(memory_order_acquire)) {
+        const SpectatorView* v = acquireSpectatorView(*f);
+        if (v) {
+            stats->reads++;
+            if (v->sequence != lastSequence) {
+                if (v->sequence < lastSequence || !isConsistentView(*v)) stats->broken++;
+                lastSequence = v->sequence;
+                stats->views++;
+            }
+            releaseSpectatorView(*f, v);
+        }
+        this_thread::yield();
+    }
+}
+
+// Plays the games and returns the turns played; feed may be null.
+long long playSpectatedGames(int games, unsigned long long seed, SpectatorFeed* feed) {
+    SimulationConfig config = {};
+    config.playersCount = 4;
+    config.deckCount = 1;
+    for (int i = 0; i < config.playersCount; i++) config.agents[i] = AGENT_BOT;
+
+    ArenaPool pool = {};
+    ostream silent(0);
+    long long turns = 0;
+    for (int n = 0; n < games; n++) {
+        GameState g = {};
+        setupSilentGame(g, pool, config, config.agents, 0, seed + n, silent, 0, 0);
+        g.spectators = feed;
+        runGameLoop(g);
+        turns += g.turns;
+        destroyGame(g, pool);
+    }
+    destroyArenaPool(pool);
+    return turns;
+}
+
+int spectateCommand(int argc, char* argv[]) {
+    int games = 20000;
+    int spectators = 4;
+    unsigned long long seed = (unsigned long long)time(0);
+
+    bool argsOk = true;
+    int positional = 0;
+    for (int i = 2; i < argc; i++) {
+        const char* arg = argv[i];
+        if (strcmp(arg, "--seed") == 0 && i + 1 < argc) seed = strtoull(argv[++i], 0, 10);
+        else if (arg[0] == '-' && arg[1] == '-') argsOk = false;
+        else if (positional == 0) { games = atoi(arg); positional++; }
+        else if (positional == 1) { spectators = atoi(arg); positional++; }
+        else argsOk = false;
+    }
+    if (!argsOk || games <= 0 || spectators < 0 || spectators > MAX_SPECTATORS) {
+        cout << "Usage: --spectate [games] [spectators 0-" << MAX_SPECTATORS << "] [--seed S]\n";
+        return 1;
+    }
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    long long plainTurns = playSpectatedGames(games, seed, 0);
+    double plainSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    SpectatorFeed* feed = createSpectatorFeed();
+    SpectatorStats stats[MAX_SPECTATORS] = {};
+    thread threads[MAX_SPECTATORS];
+    atomic<bool> stopping(false);
+    for (int i = 0; i < spectators; i++) threads[i] = thread(runSpectator, feed, &stopping, &stats[i]);
+
+    start = chrono::steady_clock::now();
+    long long turns = playSpectatedGames(games, seed, feed);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    stopping.store(true, memory_order_release);
+    for (int i = 0; i < spectators; i++) threads[i].join();
+
+    cout << "Games: " << games << " (seed " << seed << ")\n";
+    cout << "Without a feed: " << plainTurns << " turns in " << plainSeconds << " s";
+    if (plainSeconds > 0) cout << " (" << (long long)(plainTurns / plainSeconds) << " turns/s)";
+    cout << "\n";
+    cout << "With " << spectators << " spectator(s): " << turns << " turns in " << seconds << " s";
+    if (seconds > 0) cout << " (" << (long long)(turns / seconds) << " turns/s)";
+    cout << "\n";
+    cout << "Views published: " << feed->published << ", skipped: " << feed->skipped.load() << "\n";
+
+    long long broken = 0;
+    for (int i = 0; i < spectators; i++) {
+        cout << "Spectator " << (i + 1) << ": " << stats[i].views << " views seen, "
+            << stats[i].reads << " reads\n";
+        broken += stats[i].broken;
+    }
+    if (broken > 0) cout << "Broken views: " << broken << "\n";
+
+    destroySpectatorFeed(feed);
+    return broken > 0 ? 1 : 0;
+}
+
@@ -0,0 +1,35 @@
+/**
+*
+* Solution to course project # 4
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2025/2026
+*
+* @author Rangel Parishev
+* @idnumber 0MI0600668
+* @compiler GCC or Clang (-std=c++17 -pthread), VS (C++17)
+*
+* <spectator feed>
+*
+*/
+#ifndef UNO_SPECTATOR_H
+#define UNO_SPECTATOR_H
+
+#include "UNO_project_final.h"
+
+// ---------- Spectator feed ----------
+// Public views of a game for spectators on other threads, published at the
+// start of every turn; neither side locks (see UNO_spectator.cpp).
+SpectatorFeed* createSpectatorFeed();
+
+// Game thread. Fills a free slot from g and makes it the latest view.
+void publishSpectatorView(SpectatorFeed& f, const GameState& g);
+
+// Every spectator must have stopped and released its views.
+void destroySpectatorFeed(SpectatorFeed* f);
+
+// ---------- Spectating ----------
+// uno --spectate [games] [spectators] [--seed S]
+int spectateCommand(int argc, char* argv[]);
+
+#endif
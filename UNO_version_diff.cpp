@@ -0,0 +1,476 @@
+/**
+*
+* Solution to course project # 4
+* Introduction to programming course
+* Faculty of Mathematics and Informatics of Sofia University
+* Winter semester 2025/2026
+*
+* @author Rangel Parishev
+* @idnumber 0MI0600668
+* @compiler GCC or Clang (-std=c++17 -pthread), VS (C++17)
+*
+* <differential runner over the project snapshots>
+*
+*/
+
+// Runs the functions the snapshots UNO_project_commit_1..5 share with
+// UNO_project_final side by side on the same seeded inputs and reports
+// behavioural and speed differences:
+//   deck building (buildUnoDeck), shuffling with a fixed seed, move
+//   validation (isValidMove) and turn order (nextPlayer).
+//
+// Every snapshot is compiled into its own namespace of this program. The
+// standard headers are included first, so the snapshots' own #includes are
+// no-ops inside the namespaces, and time() is redirected for the snapshots
+// only, so the time-seeded shuffle of commit 5 becomes reproducible.
+//
+//   g++ -std=c++17 -O2 -pthread UNO_version_diff.cpp -o uno_version_diff
+//   ./uno_version_diff [seed] [iterations]
+
+// ---------- Libraries ----------
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <algorithm>
+#include <random>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
+#include <ctime>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#endif
+
+// ---------- Snapshots ----------
+unsigned long long snapshotTime = 0;
+unsigned long long snapshotTimeNow() { return snapshotTime; }
+#define time(t) snapshotTimeNow()
+
+// The old snapshots are kept as they were; their warnings are not ours.
+#ifdef __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wreturn-type"
+#pragma GCC diagnostic ignored "-Wunused-variable"
+#endif
+
+namespace commit1 {
+#include "UNO_project_commit_1.cpp"
+}
+namespace commit2 {
+#include "UNO_project_commit_2.cpp"
+}
+namespace commit3 {
+#include "UNO_project_commit_3.cpp"
+}
+namespace commit4 {
+#include "UNO_project_commit_4.cpp"
+}
+namespace commit5 {
+#include "UNO_project_commit_5.cpp"
+}
+
+#ifdef __GNUC__
+#pragma GCC diagnostic pop
+#endif
+
+// final seeds its games from the real clock.
+#undef time
+
+namespace final {
+#include "UNO_project_final.cpp"
+#include "UNO_files.cpp"
+#include "UNO_metrics.cpp"
+#include "UNO_sockets.cpp"
+#include "UNO_spectator.cpp"
+#include "UNO_host.cpp"
+#include "UNO_distributed.cpp"
+}
+
+using namespace std;
+
+// ---------- Cards ----------
+// Every version numbers colors and values the same way; cards are compared
+// as (color, value) pairs of ints.
+const int KIND_COLORS = 5;
+const int KIND_VALUES = 15;
+const int DECK_CARDS = 108;
+
+struct PlainCard {
+    int color;
+    int value;
+};
+
+template <typename C>
+PlainCard plain(const C& c) {
+    PlainCard p;
+    p.color = (int)c.color;
+    p.value = (int)c.value;
+    return p;
+}
+
+template <typename C>
+C makeCard(int color, int value) {
+    C c;
+    c.color = (decltype(c.color))color;
+    c.value = (decltype(c.value))value;
+    return c;
+}
+
+bool samePlain(const PlainCard& a, const PlainCard& b) {
+    return a.color == b.color && a.value == b.value;
+}
+
+// Same cards in any order.
+template <typename A, typename B>
+bool isPermutationOf(const A shuffled[], const B original[], int size) {
+    int counts[KIND_COLORS * KIND_VALUES];
+    memset(counts, 0, sizeof(counts));
+    for (int i = 0; i < size; i++) {
+        counts[(int)original[i].color * KIND_VALUES + (int)original[i].value]++;
+        counts[(int)shuffled[i].color * KIND_VALUES + (int)shuffled[i].value]--;
+    }
+    for (int k = 0; k < KIND_COLORS * KIND_VALUES; k++) {
+        if (counts[k] != 0) return false;
+    }
+    return true;
+}
+
+// Keeps results alive so timing loops are not optimized away.
+volatile long long sink;
+
+double nanosecondsSince(chrono::steady_clock::time_point start, long long operations) {
+    return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / operations;
+}
+
+// ---------- Report ----------
+// Only a change in final's behaviour counts as a difference; flaws of the
+// old snapshots are shown but are history.
+int differences = 0;
+
+void reportRow(const char* version, const char* verdict, double ns, double finalNs) {
+    cout << "  " << left << setw(10) << version << setw(44) << verdict;
+    if (ns >= 0) {
+        cout << fixed << setprecision(1) << setw(8) << ns << " ns";
+        if (finalNs > 0) cout << "  (" << setprecision(2) << ns / finalNs << "x final)";
+    }
+    cout << "\n";
+    cout.unsetf(ios::fixed);
+}
+
+void reportMissing(const char* version) {
+    reportRow(version, "not present", -1, 0);
+}
+
+// ---------- Deck building ----------
+void compareDeckBuilding(int iterations) {
+    cout << "Deck building (buildUnoDeck)\n";
+
+    final::Card finalDeck[DECK_CARDS];
+    int finalSize = 0;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        final::buildUnoDeck(finalDeck, finalSize);
+        sink = finalDeck[i % DECK_CARDS].value;
+    }
+    double finalNs = nanosecondsSince(start, iterations);
+
+    reportMissing("commit_1");
+    reportMissing("commit_2");
+    reportMissing("commit_3");
+    reportMissing("commit_4");
+
+    commit5::Card deck[DECK_CARDS];
+    int size = 0;
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        commit5::buildUnoDeck(deck, size);
+        sink = deck[i % DECK_CARDS].value;
+    }
+    double ns = nanosecondsSince(start, iterations);
+
+    bool sameOrder = size == finalSize;
+    for (int i = 0; sameOrder && i < size; i++) sameOrder = samePlain(plain(deck[i]), plain(finalDeck[i]));
+    bool sameCards = size == finalSize && isPermutationOf(deck, finalDeck, size);
+    if (!sameCards) differences++;
+    reportRow("commit_5", sameOrder ? "identical 108-card deck" : sameCards ? "same 108 cards, other order" :
+        "DIFFERENT cards", ns, finalNs);
+    reportRow("final", "reference", finalNs, 0);
+}
+
+// ---------- Shuffling ----------
+// The engines use different generators (std::default_random_engine seeded
+// from time() in commit 5, splitmix64 in final), so the permutations are not
+// expected to match. Each must be a permutation of its input, reproducible
+// from its seed, and uniform: the chi-square statistic of where the first
+// card lands has 107 degrees of freedom (99.9% critical value about 159).
+const double SHUFFLE_CHI_SQUARE_LIMIT = 159.0;
+
+double chiSquare(const int landed[], int size, int samples) {
+    double expected = (double)samples / size;
+    double chi = 0;
+    for (int i = 0; i < size; i++) chi += (landed[i] - expected) * (landed[i] - expected) / expected;
+    return chi;
+}
+
+void reportShuffle(const char* version, bool permutation, bool reproducible, double chi, double ns, double finalNs,
+    bool counted) {
+    char verdict[128];
+    snprintf(verdict, sizeof(verdict), "%s, %s, chi2 %.0f%s",
+        permutation ? "permutation" : "NOT A PERMUTATION",
+        reproducible ? "reproducible" : "NOT REPRODUCIBLE", chi,
+        chi > SHUFFLE_CHI_SQUARE_LIMIT ? " BIASED" : "");
+    if (counted && (!permutation || !reproducible || chi > SHUFFLE_CHI_SQUARE_LIMIT)) differences++;
+    reportRow(version, verdict, ns, finalNs);
+}
+
+void compareShuffling(unsigned long long seed, int iterations) {
+    cout << "Shuffling with a fixed seed (shuffleDeck)\n";
+
+    // final
+    final::Card original[DECK_CARDS], deck[DECK_CARDS], again[DECK_CARDS];
+    int size = 0;
+    final::buildUnoDeck(original, size);
+    int landed[DECK_CARDS];
+    memset(landed, 0, sizeof(landed));
+    bool permutation = true;
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        memcpy(deck, original, sizeof(deck));
+        unsigned long long rng = seed + i;
+        final::shuffleDeck(deck, size, rng);
+        for (int k = 0; k < size; k++) {
+            if (samePlain(plain(deck[k]), plain(original[0]))) { landed[k]++; break; }
+        }
+    }
+    double finalNs = nanosecondsSince(start, iterations);
+
+    memcpy(deck, original, sizeof(deck));
+    memcpy(again, original, sizeof(again));
+    unsigned long long rngA = seed, rngB = seed;
+    final::shuffleDeck(deck, size, rngA);
+    final::shuffleDeck(again, size, rngB);
+    permutation = isPermutationOf(deck, original, size);
+    bool reproducible = memcmp(deck, again, sizeof(deck)) == 0;
+    double finalChi = chiSquare(landed, size, iterations);
+
+    reportMissing("commit_1");
+    reportMissing("commit_2");
+    reportMissing("commit_3");
+    reportMissing("commit_4");
+
+    // commit 5 seeds std::default_random_engine from time(0)
+    commit5::Card original5[DECK_CARDS], deck5[DECK_CARDS], again5[DECK_CARDS];
+    int size5 = 0;
+    commit5::buildUnoDeck(original5, size5);
+    memset(landed, 0, sizeof(landed));
+
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        memcpy(deck5, original5, sizeof(deck5));
+        snapshotTime = seed + i;
+        commit5::shuffleDeck(deck5, size5);
+        for (int k = 0; k < size5; k++) {
+            if (samePlain(plain(deck5[k]), plain(original5[0]))) { landed[k]++; break; }
+        }
+    }
+    double ns = nanosecondsSince(start, iterations);
+
+    memcpy(deck5, original5, sizeof(deck5));
+    memcpy(again5, original5, sizeof(again5));
+    snapshotTime = seed;
+    commit5::shuffleDeck(deck5, size5);
+    commit5::shuffleDeck(again5, size5);
+    bool permutation5 = isPermutationOf(deck5, original5, size5);
+    bool reproducible5 = memcmp(deck5, again5, sizeof(deck5)) == 0;
+    reportShuffle("commit_5", permutation5, reproducible5, chiSquare(landed, size5, iterations), ns, finalNs, false);
+    reportShuffle("final", permutation, reproducible, finalChi, finalNs, 0, true);
+
+    bool samePermutation = true;
+    for (int i = 0; i < size; i++) samePermutation = samePermutation && samePlain(plain(deck[i]), plain(deck5[i]));
+    cout << "  commit_5 and final permutations for seed " << seed << ": "
+        << (samePermutation ? "identical" : "different (expected, different generators)") << "\n";
+}
+
+// ---------- Move validation ----------
+// Every valid (played, top card, active color) combination, then timing on
+// a seeded random stream of them.
+const int MOVE_CASES = 4096;
+
+struct MoveCase {
+    PlainCard played;
+    PlainCard top;
+    int activeColor;
+};
+
+int validKinds(PlainCard kinds[]) {
+    int count = 0;
+    for (int c = 0; c < KIND_COLORS; c++) {
+        for (int v = 0; v < KIND_VALUES; v++) {
+            if ((c == 4) != (v >= 13)) continue;
+            kinds[count].color = c;
+            kinds[count].value = v;
+            count++;
+        }
+    }
+    return count;
+}
+
+bool finalValid(const MoveCase& m) {
+    return final::isValidMove(makeCard<final::Card>(m.played.color, m.played.value),
+        makeCard<final::Card>(m.top.color, m.top.value), (final::Color)m.activeColor);
+}
+
+bool commit3Valid(const MoveCase& m) {
+    commit3::topCard = makeCard<commit3::Card>(m.top.color, m.top.value);
+    commit3::activeColor = (commit3::Color)m.activeColor;
+    return commit3::isValidMove(makeCard<commit3::Card>(m.played.color, m.played.value));
+}
+
+bool commit4Valid(const MoveCase& m) {
+    return commit4::isValidMove(makeCard<commit4::Card>(m.played.color, m.played.value),
+        makeCard<commit4::Card>(m.top.color, m.top.value), (commit4::Color)m.activeColor);
+}
+
+bool commit5Valid(const MoveCase& m) {
+    return commit5::isValidMove(makeCard<commit5::Card>(m.played.color, m.played.value),
+        makeCard<commit5::Card>(m.top.color, m.top.value), (commit5::Color)m.activeColor);
+}
+
+typedef bool (*MoveValidator)(const MoveCase&);
+
+void compareMoveValidator(const char* version, MoveValidator validate, const MoveCase cases[],
+    const PlainCard kinds[], int kindCount, int iterations, double finalNs) {
+    int mismatches = 0, total = 0;
+    for (int p = 0; p < kindCount; p++) {
+        for (int t = 0; t < kindCount; t++) {
+            for (int a = 0; a < 4; a++) {
+                MoveCase m = { kinds[p], kinds[t], a };
+                if (validate(m) != finalValid(m)) mismatches++;
+                total++;
+            }
+        }
+    }
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    long long valid = 0;
+    for (int i = 0; i < iterations; i++) valid += validate(cases[i % MOVE_CASES]);
+    sink = valid;
+    double ns = nanosecondsSince(start, iterations);
+
+    char verdict[128];
+    if (mismatches == 0) snprintf(verdict, sizeof(verdict), "identical on all %d cases", total);
+    else snprintf(verdict, sizeof(verdict), "DIFFERS on %d of %d cases", mismatches, total);
+    if (mismatches) differences++;
+    reportRow(version, verdict, ns, finalNs);
+}
+
+void compareMoveValidation(unsigned long long seed, int iterations) {
+    cout << "Move validation (isValidMove)\n";
+
+    PlainCard kinds[KIND_COLORS * KIND_VALUES];
+    int kindCount = validKinds(kinds);
+
+    MoveCase* cases = new MoveCase[MOVE_CASES];
+    unsigned long long rng = seed;
+    for (int i = 0; i < MOVE_CASES; i++) {
+        cases[i].played = kinds[final::randomBelow(rng, kindCount)];
+        cases[i].top = kinds[final::randomBelow(rng, kindCount)];
+        cases[i].activeColor = final::randomBelow(rng, 4);
+    }
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    long long valid = 0;
+    for (int i = 0; i < iterations; i++) valid += finalValid(cases[i % MOVE_CASES]);
+    sink = valid;
+    double finalNs = nanosecondsSince(start, iterations);
+
+    reportMissing("commit_1");
+    reportMissing("commit_2");
+    compareMoveValidator("commit_3", commit3Valid, cases, kinds, kindCount, iterations, finalNs);
+    compareMoveValidator("commit_4", commit4Valid, cases, kinds, kindCount, iterations, finalNs);
+    compareMoveValidator("commit_5", commit5Valid, cases, kinds, kindCount, iterations, finalNs);
+    reportRow("final", "reference", finalNs, 0);
+
+    delete[] cases;
+}
+
+// ---------- Turn order ----------
+void compareTurnOrder() {
+    cout << "Turn order (nextPlayer)\n";
+
+    int mismatches3 = 0, mismatches4 = 0, total = 0;
+    for (int players = 2; players <= 4; players++) {
+        for (int current = 0; current < players; current++) {
+            for (int direction = -1; direction <= 1; direction += 2) {
+                int expected = current;
+                final::nextPlayerIndex(expected, direction, players);
+
+                commit3::currentPlayer = current;
+                commit3::direction = direction;
+                commit3::playersCount = players;
+                commit3::nextPlayer();
+                if (commit3::currentPlayer != expected) mismatches3++;
+
+                int next4 = current;
+                commit4::nextPlayer(next4, direction, players);
+                if (next4 != expected) mismatches4++;
+                total++;
+            }
+        }
+    }
+
+    char verdict[128];
+    reportMissing("commit_1");
+    reportMissing("commit_2");
+    snprintf(verdict, sizeof(verdict), mismatches3 ? "DIFFERS on %d cases" : "identical on all %d cases",
+        mismatches3 ? mismatches3 : total);
+    reportRow("commit_3", verdict, -1, 0);
+    snprintf(verdict, sizeof(verdict), mismatches4 ? "DIFFERS on %d cases" : "identical on all %d cases",
+        mismatches4 ? mismatches4 : total);
+    reportRow("commit_4", verdict, -1, 0);
+    reportRow("commit_5", "not present", -1, 0);
+    if (mismatches3 || mismatches4) differences++;
+}
+
+// ---------- main ----------
+int main(int argc, char* argv[]) {
+    unsigned long long seed = argc > 1 ? strtoull(argv[1], 0, 10) : 1;
+    int iterations = argc > 2 ? atoi(argv[2]) : 200000;
+    if (iterations <= 0) {
+        cout << "Usage: uno_version_diff [seed] [iterations]\n";
+        return 1;
+    }
+
+    cout << "Seed " << seed << ", " << iterations << " iterations per timing\n\n";
+    compareDeckBuilding(iterations);
+    cout << "\n";
+    compareShuffling(seed, iterations);
+    cout << "\n";
+    compareMoveValidation(seed, iterations);
+    cout << "\n";
+    compareTurnOrder();
+
+    if (differences) cout << "\nBehavioural differences in final: " << differences << "\n";
+    else cout << "\nNo behavioural differences in final\n";
+    return differences ? 1 : 0;
+}
@@ -0,0 +1,66 @@
+# Kills the game at random moments while it autosaves every turn and checks
+# that autosave.txt is then either missing or a complete save that loads.
+# The writer goes through a temporary file, fsync and an atomic rename, so a
+# killed process must never leave a torn autosave.txt behind. (The fsync
+# only matters when the machine loses power, which a test cannot stage.)
+#
+#   python3 autosave_crash_test.py path/to/uno
+
+import os
+import random
+import sys
+import time
+
+from unotest import Game, fail, remove_dir, scratch_dir
+
+ROUNDS = 200
+WRITER_POLL = 0.02  # AUTOSAVE_POLL_MS
+
+
+def main():
+    uno = os.path.abspath(sys.argv[1])
+    rng = random.Random(40)
+    loaded = 0
+    for round in range(ROUNDS):
+        work = scratch_dir("autosave")
+        autosave = os.path.join(work, "autosave.txt")
+        game = Game(uno, work, ["--seed", str(round + 1), "--autosave", "1"])
+        kill_at = rng.randint(1, 30)
+        while game.moves < kill_at:
+            prompt = game.next_prompt()
+            if prompt is None:
+                break
+            if not game.answer(prompt):
+                game.play_card()
+        if game.proc.poll() is not None:
+            # Won before the kill: the autosave goes with the game.
+            if os.path.exists(autosave):
+                fail("round %d: autosave.txt left behind after a win" % round)
+            remove_dir(work)
+            continue
+
+        # The writer saves the last turn within one poll; kill anywhere in it.
+        time.sleep(rng.random() * WRITER_POLL * 1.25)
+        game.proc.kill()
+        game.proc.wait()
+
+        if os.path.exists(autosave):
+            resumed = Game(uno, work)
+            while True:
+                prompt = resumed.next_prompt()
+                if prompt is None or not resumed.answer(prompt, menu=b"2", resume_autosave=True):
+                    break
+            resumed.proc.kill()
+            resumed.proc.wait()
+            if b"Game loaded from autosave.txt" not in resumed.output:
+                fail("round %d: autosave.txt did not load after a kill:\n%s" % (round, resumed.output.decode()))
+            loaded += 1
+        remove_dir(work)
+
+    if loaded < ROUNDS // 4:
+        fail("only %d of %d killed games left an autosave behind" % (loaded, ROUNDS))
+    print("%d games, %d autosaves loaded after a kill" % (ROUNDS, loaded))
+
+
+if __name__ == "__main__":
+    main()
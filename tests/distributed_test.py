@@ -0,0 +1,76 @@
+# Runs --coordinate with three --work processes on this machine, kills one
+# worker and freezes another while they play their ranges, and checks that
+# both are dropped, their ranges are played again by the last worker and
+# the totals are exactly those of the same run under --simulate.
+#
+#   python3 distributed_test.py path/to/uno
+
+import os
+import signal
+import socket
+import subprocess
+import sys
+import time
+
+from unotest import fail
+
+GAMES = 360000
+RANGE = 60000  # long enough that a worker is killed in the middle of one
+TABLE = ["4", "1", "0"]
+SEED = "5"
+
+
+def totals(output):
+    keep = ("Seed:", "Games:", "Average turns:", "Player ")
+    return [line for line in output.splitlines() if line.startswith(keep)]
+
+
+def free_port():
+    s = socket.socket()
+    s.bind(("127.0.0.1", 0))
+    port = s.getsockname()[1]
+    s.close()
+    return port
+
+
+def main():
+    uno = os.path.abspath(sys.argv[1])
+    expected = subprocess.run([uno, "--simulate", str(GAMES)] + TABLE + ["--seed", SEED, "--threads", "4"],
+                              stdout=subprocess.PIPE, universal_newlines=True, check=True).stdout
+
+    endpoint = "127.0.0.1:%d" % free_port()
+    coordinator = subprocess.Popen([uno, "--coordinate", str(GAMES)] + TABLE +
+                                   ["--seed", SEED, "--listen", endpoint, "--range", str(RANGE), "--timeout", "2"],
+                                   stdout=subprocess.PIPE, universal_newlines=True)
+    workers = [subprocess.Popen([uno, "--work", endpoint, "--threads", "1"], stdout=subprocess.PIPE,
+                                universal_newlines=True) for _ in range(3)]
+    time.sleep(0.4)
+    killed, frozen, survivor = workers
+    killed.kill()  # disconnects in the middle of its range
+    frozen.send_signal(signal.SIGSTOP)  # stays connected but stops its heartbeat
+
+    try:
+        output = coordinator.communicate(timeout=120)[0]
+        survivor.wait(timeout=10)  # leaves on the coordinator's bye
+    finally:
+        for w in (coordinator, survivor, frozen):
+            if w.poll() is None:
+                w.kill()
+        frozen.send_signal(signal.SIGCONT)
+        for w in workers:
+            w.wait()
+    if coordinator.returncode != 0:
+        fail("the coordinator exited with %d:\n%s" % (coordinator.returncode, output))
+    if survivor.returncode != 0:
+        fail("the last worker exited with %d" % survivor.returncode)
+
+    summary = [line for line in output.splitlines() if line.startswith("Workers:")]
+    if summary != ["Workers: 3 joined, 2 lost, 2 ranges reassigned"]:
+        fail("expected both lost ranges to be reassigned:\n%s" % output)
+    if totals(output) != totals(expected):
+        fail("the distributed totals differ from --simulate:\n%s\n%s" % (output, expected))
+    print(summary[0])
+
+
+if __name__ == "__main__":
+    main()
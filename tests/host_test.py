@@ -0,0 +1,108 @@
+# Plays tables of --host as a scripted remote client: every remote seat
+# answers with a legal move, the tables are answered in random order so
+# games are parked and resumed out of turn, and a few broken moves check
+# that the host reports an error and keeps the table waiting. Every table
+# must end with a winner, and a second run with the same seeds must print
+# exactly the same transcript.
+#
+#   python3 host_test.py path/to/uno
+
+import os
+import random
+import subprocess
+import sys
+
+from unotest import fail
+
+TABLES = 40
+
+
+def playable(card, top, color):
+    if card.startswith("Wild"):
+        return True
+    return card[0] == color or card[1:] == top[1:]
+
+
+def choose_move(wait, players, rng):
+    # wait <table> <seat> <phase> <top card> <color> <pending> <hand...>
+    table, seat, phase, top, color = wait[1], int(wait[2]), wait[3], wait[4], wait[5]
+    hand = wait[7:]
+    if phase == "stack":
+        return "%s -2" % table
+    if phase == "drawn":
+        slot, choice = len(hand) - 1, rng.choice([0, 1])
+    else:
+        slots = [i for i, card in enumerate(hand) if playable(card, top, color)]
+        if not slots:
+            fail("the host asked for a play without a playable card: %s" % " ".join(wait))
+        slot = choice = rng.choice(slots)
+    swap = seat % players + 1  # any other seat, for a 7 under the 7-0 rule
+    return "%s %d %s %d uno" % (table, choice, rng.choice("RGBY") if hand[slot].startswith("Wild") else "R", swap)
+
+
+def run(uno, seats, rules, seed):
+    host = subprocess.Popen([uno, "--host", str(TABLES), seats, str(rules), "--seed", str(seed)],
+                            stdin=subprocess.PIPE, stdout=subprocess.PIPE, universal_newlines=True, bufsize=1)
+    rng = random.Random(seed)
+    transcript = []
+
+    def exchange(line):
+        host.stdin.write(line + "\n")
+        host.stdin.flush()
+        reply = host.stdout.readline().split()
+        if not reply:
+            fail("the host stopped answering after %r" % line)
+        transcript.append(line + " -> " + " ".join(reply))
+        return reply
+
+    waiting = {}
+    winners = {}
+    for _ in range(TABLES):
+        reply = host.stdout.readline().split()
+        transcript.append(" ".join(reply))
+        if reply[0] == "wait":
+            waiting[reply[1]] = reply
+        elif reply[0] == "over":
+            winners[reply[1]] = reply[2]
+
+    broken = 0
+    while waiting:
+        table = rng.choice(sorted(waiting))
+        wait = waiting[table]
+        if broken < 10 and rng.random() < 0.05:
+            broken += 1
+            bad = rng.choice(["%s 99 R 2" % table, "%s 0 Q" % table, "0 0", "x"])
+            reply = exchange(bad)
+            if reply[0] != "error":
+                fail("the host accepted the broken move %r: %s" % (bad, " ".join(reply)))
+            continue
+        reply = exchange(choose_move(wait, len(seats), rng))
+        if reply[0] == "error":
+            fail("the host turned away a legal move for %s: %s" % (" ".join(wait), " ".join(reply)))
+        del waiting[table]
+        if reply[0] == "wait":
+            waiting[reply[1]] = reply
+        elif reply[0] == "over":
+            winners[reply[1]] = reply[2]
+
+    host.stdin.close()
+    if host.wait() != 0:
+        fail("the host exited with %d" % host.returncode)
+    if len(winners) != TABLES or "0" in winners.values():
+        fail("not every table was won: %s" % winners)
+    if broken == 0:
+        fail("no broken moves were sent")
+    return transcript
+
+
+def main():
+    uno = os.path.abspath(sys.argv[1])
+    for seats, rules, seed in (("nbnb", 0, 11), ("nnr", 31, 12), ("nb", 5, 13)):
+        first = run(uno, seats, rules, seed)
+        if run(uno, seats, rules, seed) != first:
+            fail("two runs of seats %s, rules %d differ" % (seats, rules))
+        print("seats %s, rules %d: %d tables won, %d messages" % (seats, rules, TABLES, len(first)))
+
+
+if __name__ == "__main__":
+    main()
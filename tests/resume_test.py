@@ -0,0 +1,65 @@
+# Saves a seeded game at turn N, resumes it from save.txt and checks that
+# the rest of the game prints exactly what an uninterrupted game from the
+# same seed prints from turn N on: the save keeps the seed and generator
+# state, so refills after the resume shuffle the same way.
+#
+#   python3 resume_test.py path/to/uno
+
+import os
+import sys
+
+from unotest import Game, fail, remove_dir, scratch_dir
+
+TURN_VIEW = b"\n--- UNO ---\nCurrent card:"
+CARD_PROMPT = b"Choose card index"
+
+
+def from_move(output, n):
+    """The output from the table shown for card prompt n (from 1) on."""
+    at = -1
+    for _ in range(n):
+        at = output.find(CARD_PROMPT, at + 1)
+        if at < 0:
+            return None
+    return output[output.rfind(TURN_VIEW, 0, at):]
+
+
+def main():
+    uno = os.path.abspath(sys.argv[1])
+    refilled = 0
+    checked = 0
+    for seed in range(1, 13):
+        for players in (b"3", b"8"):
+            work = scratch_dir("resume")
+            args = ["--seed", str(seed), "--autosave", "0"]
+            whole = Game(uno, work, args)
+            whole.play(players=players)
+            save_at = max(1, whole.moves * (seed % 4 + 1) // 5)
+
+            saved = Game(uno, work, args)
+            saved.play(save_at=save_at, players=players)
+            if b"Game saved to save.txt" not in saved.output:
+                fail("seed %d: no save at move %d" % (seed, save_at))
+            resumed = Game(uno, work)
+            resumed.play(menu=b"2")
+            if b"Game loaded from save.txt (seed %d)" % seed not in resumed.output:
+                fail("seed %d: the save did not load with its seed:\n%s" % (seed, resumed.output[:500].decode()))
+
+            expected = from_move(whole.output, save_at)
+            if not whole.output.startswith(saved.output[:saved.output.rfind(CARD_PROMPT)]):
+                fail("seed %d: the saved game played differently before the save" % seed)
+            got = resumed.output[resumed.output.find(TURN_VIEW):]
+            if got != expected:
+                fail("seed %d, %s players: resuming at move %d changed the game" % (seed, players.decode(), save_at))
+            if b"refilled" in expected:
+                refilled += 1
+            checked += 1
+            remove_dir(work)
+
+    if refilled == 0:
+        fail("no resumed game refilled its deck")
+    print("%d games resumed, %d of them refilled after the save" % (checked, refilled))
+
+
+if __name__ == "__main__":
+    main()
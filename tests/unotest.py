@@ -0,0 +1,114 @@
+# Helpers shared by the tests: a scratch directory per test and a scripted
+# player for the interactive game. The game asks everything on stdin; cin is
+# tied to cout, so every prompt is flushed before the game waits for input.
+
+import os
+import re
+import select
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+HAND_SLOT = re.compile(rb"\[(\d+)\] \S+\*")
+
+
+def fail(message):
+    print("FAIL: " + message)
+    sys.exit(1)
+
+
+def scratch_dir(name):
+    return tempfile.mkdtemp(prefix="uno_" + name + "_")
+
+
+def remove_dir(path):
+    shutil.rmtree(path, ignore_errors=True)
+
+
+class Game:
+    """The interactive game in cwd, answered by a fixed strategy: the first
+    playable card, red for wilds, always play a drawn card and declare UNO."""
+
+    def __init__(self, uno, cwd, args=()):
+        self.proc = subprocess.Popen([uno] + list(args), cwd=cwd, stdin=subprocess.PIPE,
+                                     stdout=subprocess.PIPE, stderr=subprocess.STDOUT, bufsize=0)
+        self.output = b""
+        self.read_to = 0  # output before this offset has been answered
+        self.moves = 0    # card prompts answered so far
+
+    def next_prompt(self, timeout=20):
+        """Waits for the next prompt and returns it, or None at exit."""
+        deadline = time.time() + timeout
+        fd = self.proc.stdout.fileno()
+        while True:
+            tail = self.output[self.read_to:]
+            if tail.endswith(b": "):
+                self.read_to = len(self.output)
+                return tail[tail.rfind(b"\n") + 1:]
+            left = deadline - time.time()
+            if left <= 0:
+                self.proc.kill()
+                fail("no prompt from the game in %d s; last output:\n%s" % (timeout, tail[-500:].decode()))
+            ready, _, _ = select.select([fd], [], [], left)
+            if not ready:
+                continue
+            chunk = os.read(fd, 65536)
+            if not chunk:
+                self.proc.wait()
+                return None
+            self.output += chunk
+
+    def send(self, answer):
+        self.proc.stdin.write(answer.encode() + b"\n")
+        self.proc.stdin.flush()
+
+    def answer(self, prompt, menu=b"1", players=b"3", decks=b"1", resume_autosave=False):
+        """Answers one prompt with the strategy; returns False for a card
+        prompt, which the caller answers with play_card or save."""
+        if prompt == b"Choose: ":
+            self.send(menu.decode())
+        elif b"number of players" in prompt:
+            self.send(players.decode())
+        elif b"combined decks" in prompt:
+            self.send(decks.decode())
+        elif b"house rules" in prompt:
+            self.send("n")
+        elif b"autosaved" in prompt:
+            self.send("y" if resume_autosave else "n")
+        elif b"(y/n)" in prompt:
+            self.send("y")
+        elif b"Choose color" in prompt:
+            self.send("R")
+        elif b"declare UNO" in prompt:
+            self.send("uno")
+        elif b"Choose card index" in prompt:
+            return False
+        else:
+            fail("unexpected prompt %r" % prompt)
+        return True
+
+    def play_card(self):
+        hand = self.output[:self.read_to]
+        hand = hand[hand.rfind(b"Your cards:"):]
+        slot = HAND_SLOT.search(hand)
+        if not slot:
+            fail("no playable card in %r" % hand)
+        self.moves += 1
+        self.send(slot.group(1).decode())
+
+    def play(self, save_at=None, **answers):
+        """Plays until the game exits; saves and quits at card prompt
+        save_at (counted from 1) when it is given. Returns the exit code."""
+        while True:
+            prompt = self.next_prompt()
+            if prompt is None:
+                return self.proc.returncode
+            if self.answer(prompt, **answers):
+                continue
+            if save_at is not None and self.moves + 1 == save_at:
+                self.send("-1")
+                save_at = None
+            else:
+                self.play_card()